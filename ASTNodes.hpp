@@ -1,8 +1,15 @@
+#pragma once
 #include <iostream>
 #include <string>
 #include <cctype>
 #include <vector>
 #include <algorithm>
+#include <new>
+#include <utility>
+#include <cstdint>
+#include <type_traits>
+#include "OutputSink.hpp"
+#include "StringPool.hpp"
 
 using namespace std;
 
@@ -40,7 +47,8 @@ enum class ASTNodeType
     Literal,      // 常量
     Identifier,   // 标识符
     FuncCallExpr, // 函数调用
-    AssignExpr    // 赋值表达式
+    AssignExpr,   // 赋值表达式
+    Verbatim      // 错误恢复时原样保留的源码
 };
 
 enum class VarKind
@@ -164,30 +172,178 @@ class ASTNode
 {
 public:
     ASTNodeType type;
+    // 顶层定义与语句块中的语句在源码中的范围 [sourceBegin, sourceEnd)，其余节点为空
+    const char *sourceBegin = nullptr;
+    const char *sourceEnd = nullptr;
     ASTNode(ASTNodeType t) : type(t) {}
-    virtual ~ASTNode() = default;
+    void setSource(const char *begin, const char *end)
+    {
+        sourceBegin = begin;
+        sourceEnd = end;
+    }
+    // 没有虚析构函数：节点只含指针、Symbol 与 ArenaArray，可平凡析构，由 ASTArena 整块释放而不逐个析构
     virtual void print(int indent = 0) const = 0;
-    virtual void printToFile(ostream &out, int indent = 0) const = 0;
-    virtual void printInForLoop(ostream &out, int indent = 0) const {}
-    virtual void printElseIf(ostream &out, int indent = 0) const {}
+    virtual void printToFile(OutputSink &out, int indent = 0) const = 0;
+    virtual void printInForLoop(OutputSink &out, int indent = 0) const {}
+    virtual void printElseIf(OutputSink &out, int indent = 0) const {}
 };
 
-class ProgramNode : public ASTNode
+// 分配在 ASTArena 中的定长数组，节点用它代替 vector 保存子节点与名称列表
+// 本身只是指针与长度，可平凡析构，内容随 arena 一起释放
+template <typename T>
+class ArenaArray
 {
+private:
+    const T *items = nullptr;
+    size_t count = 0;
+
 public:
-    vector<ASTNode *> extdeflists;
-    ProgramNode() : ASTNode(ASTNodeType::Program) {}
-    ~ProgramNode()
+    ArenaArray() {}
+    ArenaArray(const T *data, size_t size) : items(data), count(size) {}
+    const T *begin() const { return items; }
+    const T *end() const { return items + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const T &operator[](size_t i) const { return items[i]; }
+    const T &front() const { return items[0]; }
+    const T &back() const { return items[count - 1]; }
+};
+
+class ASTArena;
+
+// make() 的参数在节点中的存放形式：vector 复制为 arena 中的 ArenaArray（逐层），string 驻留为 Symbol，其余原样传递
+template <typename T>
+struct ArenaStored
+{
+    typedef const T &type;
+    static const T &store(ASTArena &, const T &value) { return value; }
+};
+template <typename T>
+struct ArenaStored<vector<T>>
+{
+    typedef ArenaArray<typename decay<typename ArenaStored<T>::type>::type> type;
+    static type store(ASTArena &arena, const vector<T> &values);
+};
+template <>
+struct ArenaStored<string>
+{
+    typedef Symbol type;
+    static Symbol store(ASTArena &arena, const string &value);
+};
+
+// 一次解析产生的全部 AST 节点的所有者
+// 节点与 ArenaArray 的内容按顺序分配在大块内存中，彼此相邻；节点可平凡析构，
+// 整棵树随 reset() 或 arena 析构一起释放，不逐个析构，内存块在 reset() 后留作复用
+class ASTArena
+{
+private:
+    static const size_t BLOCK_SIZE = 64 * 1024;
+    vector<char *> blocks;
+    vector<char *> largeBlocks; // 超过半个块的数组单独分配，reset() 时释放
+    size_t blockIndex = 0; // 当前正在使用的内存块
+    char *ptr = nullptr;
+    char *limit = nullptr;
+    size_t nodes = 0;     // 已分配的节点数
+    StringPool strings;   // 节点中的标识符与运算符
+
+    void *allocate(size_t size, size_t align)
     {
-        for (auto def : extdeflists)
+        if (size > BLOCK_SIZE / 2)
         {
-            if (def)
-            {
-                delete def;
-            }
+            largeBlocks.push_back(new char[size + align]);
+            char *p = largeBlocks.back();
+            return p + (align - reinterpret_cast<uintptr_t>(p) % align) % align;
+        }
+        size_t pad = (align - reinterpret_cast<uintptr_t>(ptr) % align) % align;
+        if (ptr == nullptr || pad + size > static_cast<size_t>(limit - ptr))
+        {
+            // 当前块已用完：优先复用 reset() 之前申请过的块
+            size_t next = ptr == nullptr ? blockIndex : blockIndex + 1;
+            if (next == blocks.size())
+                blocks.push_back(new char[BLOCK_SIZE]);
+            blockIndex = next;
+            ptr = blocks[blockIndex];
+            limit = ptr + BLOCK_SIZE;
+            pad = (align - reinterpret_cast<uintptr_t>(ptr) % align) % align;
         }
-        // extdeflists.clear();
+        void *mem = ptr + pad;
+        ptr += pad + size;
+        return mem;
     }
+
+public:
+    ASTArena() {}
+    ASTArena(const ASTArena &) = delete;
+    ASTArena &operator=(const ASTArena &) = delete;
+    ~ASTArena()
+    {
+        reset();
+        for (auto block : blocks)
+            delete[] block;
+    }
+
+    // 构造一个节点；vector 与 string 参数按 ArenaStored 转换后传给构造函数
+    template <typename T, typename... Args>
+    T *make(const Args &...args)
+    {
+        static_assert(sizeof(T) <= BLOCK_SIZE, "node too large for arena block");
+        static_assert(is_trivially_destructible<T>::value, "arena nodes are never destroyed");
+        T *node = new (allocate(sizeof(T), alignof(T))) T(ArenaStored<Args>::store(*this, args)...);
+        nodes++;
+        return node;
+    }
+
+    // 把 values 复制到 arena 中
+    template <typename T>
+    typename ArenaStored<vector<T>>::type array(const vector<T> &values)
+    {
+        typedef typename ArenaStored<vector<T>>::type Array;
+        typedef typename decay<decltype(*Array().begin())>::type Item;
+        static_assert(is_trivially_destructible<Item>::value, "arena arrays are never destroyed");
+        if (values.empty())
+            return Array();
+        Item *items = static_cast<Item *>(allocate(sizeof(Item) * values.size(), alignof(Item)));
+        for (size_t i = 0; i < values.size(); ++i)
+            new (items + i) Item(ArenaStored<T>::store(*this, values[i]));
+        return Array(items, values.size());
+    }
+
+    // 驻留一个标识符或运算符，与节点同生命周期
+    Symbol intern(const SourceRef &s) { return strings.symbol(s); }
+    Symbol intern(const string &s) { return strings.symbol(s); }
+
+    // 释放所有节点与驻留的字符串：节点不需要析构，只需回到第一个内存块，已申请的块留给下一次解析使用
+    void reset()
+    {
+        for (auto block : largeBlocks)
+            delete[] block;
+        largeBlocks.clear();
+        nodes = 0;
+        strings.clear();
+        blockIndex = 0;
+        ptr = nullptr;
+        limit = nullptr;
+    }
+
+    size_t nodeCount() const { return nodes; }
+    size_t blockCount() const { return blocks.size(); }
+};
+
+template <typename T>
+typename ArenaStored<vector<T>>::type ArenaStored<vector<T>>::store(ASTArena &arena, const vector<T> &values)
+{
+    return arena.array(values);
+}
+inline Symbol ArenaStored<string>::store(ASTArena &arena, const string &value)
+{
+    return arena.intern(value);
+}
+
+class ProgramNode : public ASTNode
+{
+public:
+    ArenaArray<ASTNode *> extdeflists;
+    ProgramNode(ArenaArray<ASTNode *> items) : ASTNode(ASTNodeType::Program), extdeflists(items) {}
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "Program\n";
@@ -203,19 +359,24 @@ public:
             }
         }
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    // 输出第 i 个顶层定义；各定义的输出只取决于它自身与 indent
+    void printItem(OutputSink &out, size_t i, int indent) const
     {
-        out << string(indent, ' ');
-        for (auto def : extdeflists)
+        if (extdeflists[i])
         {
-            if (def)
-            {
-                def->printToFile(out, indent);
-            }
-            else
-            {
-                out << string(indent, '\t') << "Error: Null ExtDef\n";
-            }
+            extdeflists[i]->printToFile(out, indent);
+        }
+        else
+        {
+            out.indent(indent) << "Error: Null ExtDef\n";
+        }
+    }
+    void printToFile(OutputSink &out, int indent = 0) const override
+    {
+        out.indent(indent, ' ');
+        for (size_t i = 0; i < extdeflists.size(); ++i)
+        {
+            printItem(out, i, indent);
         }
     }
 };
@@ -223,23 +384,23 @@ public:
 class Preprocessor : public ASTNode
 {
 public:
-    string directive;
-    Preprocessor(const string &dir) : ASTNode(ASTNodeType::Preprocessor), directive(dir) {}
+    Symbol directive;
+    Preprocessor(Symbol dir) : ASTNode(ASTNodeType::Preprocessor), directive(dir) {}
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "Preprocessor: " << directive << "\n";
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << directive << "\n";
+        out.indent(indent) << directive << "\n";
     }
 };
 
 class TypeSpec : public ASTNode
 {
 public:
-    vector<string> typeName; // 类型名称，例如 "int", "float"
-    TypeSpec(const vector<string> &names)
+    ArenaArray<Symbol> typeName; // 类型名称，例如 "int", "float"
+    TypeSpec(ArenaArray<Symbol> names)
         : ASTNode(ASTNodeType::TypeSpec), typeName(names) {}
     void print(int indent = 0) const override
     {
@@ -250,7 +411,7 @@ public:
         }
         cout << "\n";
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         for (const auto &name : typeName)
         {
@@ -263,29 +424,11 @@ class VarDeclNode : public ASTNode
 {
 public:
     TypeSpec *typeName = nullptr;
-    string name;                  // 变量名
-    vector<ASTNode *> arraySizes; // 数组维度大小表达式列表
+    Symbol name;                  // 变量名
+    ArenaArray<ASTNode *> arraySizes; // 数组维度大小表达式列表
     ASTNode *init = nullptr;      // 初始化表达式，若无初始化则为 nullptr
-    VarDeclNode(TypeSpec *type, const string &varName, const vector<ASTNode *> &sizes, ASTNode *initializer = nullptr)
+    VarDeclNode(TypeSpec *type, Symbol varName, ArenaArray<ASTNode *> sizes, ASTNode *initializer = nullptr)
         : ASTNode(ASTNodeType::VarDeclList), typeName(type), name(varName), arraySizes(sizes), init(initializer) {}
-    ~VarDeclNode()
-    {
-        if (typeName)
-        {
-            delete typeName;
-        }
-        for (auto size : arraySizes)
-        {
-            if (size)
-            {
-                delete size;
-            }
-        }
-        if (init)
-        {
-            delete init;
-        }
-    }
 
     void print(int indent = 0) const override
     {
@@ -318,9 +461,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        /*out << string(indent, '\t');
+        /*out.indent(indent);
         if (typeName)
         {
             for(const auto &varType : typeName->typeName) {
@@ -352,19 +495,9 @@ public:
 class VarInitList : public ASTNode
 {
 public:
-    vector<ASTNode *> inits;
-    VarInitList(const vector<ASTNode *> &initializers)
+    ArenaArray<ASTNode *> inits;
+    VarInitList(ArenaArray<ASTNode *> initializers)
         : ASTNode(ASTNodeType::VarDeclList), inits(initializers) {}
-    ~VarInitList()
-    {
-        for (auto init : inits)
-        {
-            if (init)
-            {
-                delete init;
-            }
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "VarInitList: {\n";
@@ -382,7 +515,7 @@ public:
         cout << string(indent, ' ') << "}\n";
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         out << "{ ";
         for (size_t i = 0; i < inits.size(); ++i)
@@ -407,19 +540,9 @@ public:
 class LocalVarDecl : public ASTNode
 {
 public:
-    vector<VarDeclNode *> varDecls; // 变量声明列表
-    LocalVarDecl(const vector<VarDeclNode *> &vars)
+    ArenaArray<VarDeclNode *> varDecls; // 变量声明列表
+    LocalVarDecl(ArenaArray<VarDeclNode *> vars)
         : ASTNode(ASTNodeType::LocalVarDecl), varDecls(vars) {}
-    ~LocalVarDecl()
-    {
-        for (auto var : varDecls)
-        {
-            if (var)
-            {
-                delete var;
-            }
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "LocalVarDecl:\n";
@@ -436,9 +559,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t');
+        out.indent(indent);
         for (const auto &varType : varDecls[0]->typeName->typeName)
         {
             out << varType << " ";
@@ -475,9 +598,9 @@ public:
         out << ";\n";
     }
 
-    void printInForLoop(ostream &out, int indent = 0) const
+    void printInForLoop(OutputSink &out, int indent = 0) const
     {
-        out << string(indent, '\t');
+        out.indent(indent);
         for (const auto &varType : varDecls[0]->typeName->typeName)
         {
             out << varType << " ";
@@ -518,19 +641,9 @@ public:
 class ExtVarDecl : public ASTNode
 {
 public:
-    vector<VarDeclNode *> varDecls;
-    ExtVarDecl(const vector<VarDeclNode *> &vars)
+    ArenaArray<VarDeclNode *> varDecls;
+    ExtVarDecl(ArenaArray<VarDeclNode *> vars)
         : ASTNode(ASTNodeType::ExtVarDecl), varDecls(vars) {}
-    ~ExtVarDecl()
-    {
-        for (auto var : varDecls)
-        {
-            if (var)
-            {
-                delete var;
-            }
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "ExtVarDecl:\n";
@@ -547,9 +660,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t');
+        out.indent(indent);
         for (const auto &varType : varDecls[0]->typeName->typeName)
         {
             out << varType << " ";
@@ -591,31 +704,13 @@ class FunctionDef : public ASTNode
 {
 public:
     TypeSpec *returnType = nullptr;              // 返回类型
-    string functionName;                         // 函数名
-    vector<pair<TypeSpec *, string>> parameters; // 参数列表，包含类型和名称
+    Symbol functionName;                         // 函数名
+    ArenaArray<pair<TypeSpec *, Symbol>> parameters; // 参数列表，包含类型和名称
     ASTNode *body = nullptr;                     // 函数体
 
-    FunctionDef(TypeSpec *retType, const string &funcName,
-                const vector<pair<TypeSpec *, string>> &params, ASTNode *bdy)
+    FunctionDef(TypeSpec *retType, Symbol funcName,
+                ArenaArray<pair<TypeSpec *, Symbol>> params, ASTNode *bdy)
         : ASTNode(ASTNodeType::FunctionDef), returnType(retType), functionName(funcName), parameters(params), body(bdy) {}
-    ~FunctionDef()
-    {
-        if (returnType)
-        {
-            delete returnType;
-        }
-        for (auto &param : parameters)
-        {
-            if (param.first)
-            {
-                delete param.first;
-            }
-        }
-        if (body)
-        {
-            delete body;
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "FunctionDef: " << functionName << "\n";
@@ -652,9 +747,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t');
+        out.indent(indent);
         for (const auto &varType : returnType->typeName)
         {
             out << varType << " ";
@@ -695,28 +790,11 @@ class FuncionDeclNode : public ASTNode
 {
 public:
     TypeSpec *returnType = nullptr;                      // 返回类型
-    vector<string> functionNames;                        // 函数名
-    vector<vector<pair<TypeSpec *, string>>> parameters; // 参数列表，包含类型和名称
-    FuncionDeclNode(TypeSpec *retType, const vector<string> &funcName,
-                    const vector<vector<pair<TypeSpec *, string>>> &params)
+    ArenaArray<Symbol> functionNames;                        // 函数名
+    ArenaArray<ArenaArray<pair<TypeSpec *, Symbol>>> parameters; // 参数列表，包含类型和名称
+    FuncionDeclNode(TypeSpec *retType, ArenaArray<Symbol> funcName,
+                    ArenaArray<ArenaArray<pair<TypeSpec *, Symbol>>> params)
         : ASTNode(ASTNodeType::FunctionDecl), returnType(retType), functionNames(funcName), parameters(params) {}
-    ~FuncionDeclNode()
-    {
-        if (returnType)
-        {
-            delete returnType;
-        }
-        for (auto &param : parameters)
-        {
-            for (auto &p : param)
-            {
-                if (p.first)
-                {
-                    delete p.first;
-                }
-            }
-        }
-    }
     void print(int indent = 0) const override
     {
         int i = 0;
@@ -750,11 +828,11 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         for (size_t i = 0; i < functionNames.size(); ++i)
         {
-            out << string(indent, '\t');
+            out.indent(indent);
             for (const auto &varType : returnType->typeName)
             {
                 out << varType << " ";
@@ -788,16 +866,9 @@ class TypeDefNode : public ASTNode
 {
 public:
     TypeSpec *typeName = nullptr; // 类型名称
-    vector<string> alias;         // 别名
-    TypeDefNode(TypeSpec *type, const vector<string> &al)
+    ArenaArray<Symbol> alias;         // 别名
+    TypeDefNode(TypeSpec *type, ArenaArray<Symbol> al)
         : ASTNode(ASTNodeType::TypeDef), typeName(type), alias(al) {}
-    ~TypeDefNode()
-    {
-        if (typeName)
-        {
-            delete typeName;
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "TypeDef: \n";
@@ -822,9 +893,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "typedef ";
+        out.indent(indent) << "typedef ";
         for (const auto &varType : typeName->typeName)
         {
             out << varType << " ";
@@ -844,17 +915,10 @@ public:
 class CompoundStmt : public ASTNode
 {
 public:
-    vector<ASTNode *> statements; // 语句列表
-    CompoundStmt(/*const vector<ASTNode *> &vars, */ const vector<ASTNode *> &stmts)
+    ArenaArray<ASTNode *> statements; // 语句列表
+    int childIndent = 1;          // 语句输出时的缩进层数（由解析器记录）
+    CompoundStmt(/*const vector<ASTNode *> &vars, */ ArenaArray<ASTNode *> stmts)
         : ASTNode(ASTNodeType::CompoundStmt), /*vardecls(vars),*/ statements(stmts) {}
-    ~CompoundStmt()
-    {
-        for (auto stmt : statements)
-        {
-            if (stmt)
-                delete stmt;
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "CompoundStmt:\n";
@@ -872,23 +936,30 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    // 输出第 i 条语句，indent 为语句本身的缩进
+    void printStatement(OutputSink &out, size_t i, int indent) const
     {
-        out << string(indent, '\t') << "{\n";
-        for (const auto &stmt : statements)
+        const ASTNode *stmt = statements[i];
+        if (stmt)
         {
-            if (stmt)
-            {
-                stmt->printToFile(out, indent + 1);
-                if (stmt->type == ASTNodeType::BinaryExpr)
-                    out << ";\n";
-            }
-            else
-            {
-                out << string(indent + 1, '\t') << "/* Error: Null Statement */\n";
-            }
+            stmt->printToFile(out, indent);
+            if (stmt->type == ASTNodeType::BinaryExpr)
+                out << ";\n";
+        }
+        else
+        {
+            out.indent(indent) << "/* Error: Null Statement */\n";
+        }
+    }
+
+    void printToFile(OutputSink &out, int indent = 0) const override
+    {
+        out.indent(indent) << "{\n";
+        for (size_t i = 0; i < statements.size(); ++i)
+        {
+            printStatement(out, i, indent + 1);
         }
-        out << string(indent, '\t') << "}\n";
+        out.indent(indent) << "}\n";
     }
 };
 
@@ -898,17 +969,8 @@ public:
     ASTNode *condition = nullptr;
     ASTNode *thenBranch = nullptr;
     ASTNode *elseBranch = nullptr;
-    vector<ASTNode *> elseifBranches; // 支持多个 else if 分支
+    ArenaArray<ASTNode *> elseifBranches; // 支持多个 else if 分支
     IfStmt(ASTNode *cond, ASTNode *thenB, ASTNode *elseB) : ASTNode(ASTNodeType::IfStmt), condition(cond), thenBranch(thenB), elseBranch(elseB) {}
-    ~IfStmt()
-    {
-        if (condition)
-            delete condition;
-        if (thenBranch)
-            delete thenBranch;
-        if (elseBranch)
-            delete elseBranch;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "IfStmt:\n";
@@ -919,7 +981,6 @@ public:
         }
         else
         {
-            throw runtime_error("expected expression in if condition");
             cout << string(indent + 2, ' ') << "Error: Null Condition\n";
         }
         if (thenBranch)
@@ -943,9 +1004,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "if (";
+        out.indent(indent) << "if (";
         if (condition)
         {
             condition->printToFile(out, 0);
@@ -959,7 +1020,7 @@ public:
         {
             if (thenBranch->type == ASTNodeType::BinaryExpr)
             {
-                out << string(indent + 1, '\t');
+                out.indent(indent + 1);
                 thenBranch->printToFile(out, 0);
                 out << ";\n";
             }
@@ -974,18 +1035,18 @@ public:
         }
         if (elseBranch && elseBranch->type == ASTNodeType::IfStmt)
         {
-            out << string(indent, '\t') << "else ";
+            out.indent(indent) << "else ";
             elseBranch->printElseIf(out, indent);
         }
         else if (elseBranch)
         {
-            out << string(indent, '\t') << "else ";
+            out.indent(indent) << "else ";
             elseBranch->printToFile(out, indent);
         }
         out << "\n";
     }
 
-    void printElseIf(ostream &out, int indent = 0) const
+    void printElseIf(OutputSink &out, int indent = 0) const
     {
         out << "if (";
         if (condition)
@@ -1001,7 +1062,7 @@ public:
         {
             if (thenBranch->type == ASTNodeType::BinaryExpr)
             {
-                out << string(indent + 1, '\t');
+                out.indent(indent + 1);
                 thenBranch->printToFile(out, 0);
                 out << ";\n";
             }
@@ -1016,12 +1077,12 @@ public:
         }
         if (elseBranch && elseBranch->type == ASTNodeType::IfStmt)
         {
-            out << string(indent, '\t') << "else ";
+            out.indent(indent) << "else ";
             elseBranch->printElseIf(out, indent);
         }
         else if (elseBranch)
         {
-            out << string(indent, '\t') << "else ";
+            out.indent(indent) << "else ";
             elseBranch->printToFile(out, indent);
         }
     }
@@ -1032,11 +1093,6 @@ class ThenStmt : public ASTNode
 public:
     ASTNode *ThenBranch = nullptr;
     ThenStmt(ASTNode *thenB) : ASTNode(ASTNodeType::THenStmt), ThenBranch(thenB) {}
-    ~ThenStmt()
-    {
-        if (ThenBranch)
-            delete ThenBranch;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "ThenStmt:\n";
@@ -1050,7 +1106,7 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         if (ThenBranch)
         {
@@ -1058,7 +1114,7 @@ public:
         }
         else
         {
-            out << string(indent, '\t') << "{ /* Error: Null Then Branch */ }";
+            out.indent(indent) << "{ /* Error: Null Then Branch */ }";
         }
     }
 };
@@ -1068,11 +1124,6 @@ class ElseStmt : public ASTNode
 public:
     ASTNode *ElseBranch = nullptr;
     ElseStmt(ASTNode *elseB) : ASTNode(ASTNodeType::ElseStmt), ElseBranch(elseB) {}
-    ~ElseStmt()
-    {
-        if (ElseBranch)
-            delete ElseBranch;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "ElseStmt:\n";
@@ -1086,7 +1137,7 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         if (ElseBranch)
         {
@@ -1106,13 +1157,6 @@ public:
     ASTNode *condition = nullptr;
     ASTNode *body = nullptr;
     WhileStmt(ASTNode *cond, ASTNode *bdy) : ASTNode(ASTNodeType::WhileStmt), condition(cond), body(bdy) {}
-    ~WhileStmt()
-    {
-        if (condition)
-            delete condition;
-        if (body)
-            delete body;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "WhileStmt:\n";
@@ -1136,9 +1180,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "while (";
+        out.indent(indent) << "while (";
         if (condition)
         {
             condition->printToFile(out, 0);
@@ -1152,7 +1196,7 @@ public:
         {
             if(body->type == ASTNodeType::BinaryExpr)
             {
-                out << string(indent + 1, '\t');
+                out.indent(indent + 1);
                 body->printToFile(out, 0);
                 out << ";\n";
             }
@@ -1175,13 +1219,6 @@ public:
     ASTNode *body = nullptr;
     ASTNode *condition = nullptr;
     DoWhileStmt(ASTNode *bdy, ASTNode *cond) : ASTNode(ASTNodeType::DoWhileStmt), body(bdy), condition(cond) {}
-    ~DoWhileStmt()
-    {
-        if (body)
-            delete body;
-        if (condition)
-            delete condition;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "DoWhileStmt:\n";
@@ -1205,9 +1242,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "do ";
+        out.indent(indent) << "do ";
         if (body)
         {
             body->printToFile(out, indent);
@@ -1216,7 +1253,7 @@ public:
         {
             out << "{ /* Error: Null Body */ }";
         }
-        out << string(indent, '\t') << "while (";
+        out.indent(indent) << "while (";
         if (condition)
         {
             condition->printToFile(out, 0);
@@ -1234,11 +1271,6 @@ class ReturnStmt : public ASTNode
 public:
     ASTNode *expression = nullptr;
     ReturnStmt(ASTNode *expr) : ASTNode(ASTNodeType::ReturnStmt), expression(expr) {}
-    ~ReturnStmt()
-    {
-        if (expression)
-            delete expression;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "ReturnStmt:\n";
@@ -1253,9 +1285,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "return";
+        out.indent(indent) << "return";
         if (expression)
         {
             out << " ";
@@ -1269,22 +1301,10 @@ class SwitchStmt : public ASTNode
 {
 public:
     ASTNode *expression = nullptr;
-    vector<ASTNode *> cases;
+    ArenaArray<ASTNode *> cases;
     ASTNode *defaultCase = nullptr;
-    SwitchStmt(ASTNode *expr, const vector<ASTNode *> &caseList, ASTNode *defCase)
+    SwitchStmt(ASTNode *expr, ArenaArray<ASTNode *> caseList, ASTNode *defCase)
         : ASTNode(ASTNodeType::SwitchStmt), expression(expr), cases(caseList), defaultCase(defCase) {}
-    ~SwitchStmt()
-    {
-        if (expression)
-            delete expression;
-        for (auto caseStmt : cases)
-        {
-            if (caseStmt)
-                delete caseStmt;
-        }
-        if (defaultCase)
-            delete defaultCase;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "SwitchStmt:\n";
@@ -1316,9 +1336,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "switch (";
+        out.indent(indent) << "switch (";
         if (expression)
         {
             expression->printToFile(out, 0);
@@ -1336,14 +1356,14 @@ public:
             }
             else
             {
-                out << string(indent + 1, '\t') << "/* Error: Null Case Statement */\n";
+                out.indent(indent + 1) << "/* Error: Null Case Statement */\n";
             }
         }
         if (defaultCase)
         {
             defaultCase->printToFile(out, indent + 1);
         }
-        out << string(indent, '\t') << "}\n";
+        out.indent(indent) << "}\n";
     }
 };
 
@@ -1351,19 +1371,9 @@ class SwitchCase : public ASTNode
 {
 public:
     ASTNode *caseValue = nullptr;
-    vector<ASTNode *> statements;
-    SwitchCase(ASTNode *value, const vector<ASTNode *> &stmts)
+    ArenaArray<ASTNode *> statements;
+    SwitchCase(ASTNode *value, ArenaArray<ASTNode *> stmts)
         : ASTNode(ASTNodeType::SwitchCase), caseValue(value), statements(stmts) {}
-    ~SwitchCase()
-    {
-        if (caseValue)
-            delete caseValue;
-        for (auto stmt : statements)
-        {
-            if (stmt)
-                delete stmt;
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "SwitchCase:\n";
@@ -1390,9 +1400,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "case ";
+        out.indent(indent) << "case ";
         if (caseValue)
         {
             caseValue->printToFile(out, 0);
@@ -1410,7 +1420,7 @@ public:
             }
             else
             {
-                out << string(indent + 1, '\t') << "/* Error: Null Statement */\n";
+                out.indent(indent + 1) << "/* Error: Null Statement */\n";
             }
         }
     }
@@ -1419,17 +1429,9 @@ public:
 class DefaultCase : public ASTNode
 {
 public:
-    vector<ASTNode *> statements;
-    DefaultCase(const vector<ASTNode *> &stmts)
+    ArenaArray<ASTNode *> statements;
+    DefaultCase(ArenaArray<ASTNode *> stmts)
         : ASTNode(ASTNodeType::DefaultCase), statements(stmts) {}
-    ~DefaultCase()
-    {
-        for (auto stmt : statements)
-        {
-            if (stmt)
-                delete stmt;
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "DefaultCase:\n";
@@ -1447,9 +1449,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "default:\n";
+        out.indent(indent) << "default:\n";
         for (const auto &stmt : statements)
         {
             if (stmt)
@@ -1458,7 +1460,7 @@ public:
             }
             else
             {
-                out << string(indent + 1, '\t') << "/* Error: Null Statement */\n";
+                out.indent(indent + 1) << "/* Error: Null Statement */\n";
             }
         }
     }
@@ -1472,17 +1474,6 @@ public:
     ASTNode *increment = nullptr;
     ASTNode *body = nullptr;
     ForStmt(ASTNode *ini, ASTNode *cond, ASTNode *inc, ASTNode *bdy) : ASTNode(ASTNodeType::ForStmt), init(ini), condition(cond), increment(inc), body(bdy) {}
-    ~ForStmt()
-    {
-        if (init)
-            delete init;
-        if (condition)
-            delete condition;
-        if (increment)
-            delete increment;
-        if (body)
-            delete body;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "ForStmt:\n";
@@ -1524,9 +1515,9 @@ public:
         }
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "for (";
+        out.indent(indent) << "for (";
         if (init)
         {
 
@@ -1574,7 +1565,7 @@ public:
         {
             if(body->type == ASTNodeType::BinaryExpr)
             {
-                out << string(indent + 1, '\t');
+                out.indent(indent + 1);
                 body->printToFile(out, 0);
                 out << ";\n";
             }
@@ -1600,9 +1591,9 @@ public:
         cout << string(indent, ' ') << "BreakStmt\n";
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "break;\n";
+        out.indent(indent) << "break;\n";
     }
 };
 
@@ -1614,9 +1605,9 @@ public:
     {
         cout << string(indent, ' ') << "ContinueStmt\n";
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << "continue;\n";
+        out.indent(indent) << "continue;\n";
     }
 };
 
@@ -1625,11 +1616,6 @@ class Statement : public ASTNode
 public:
     ASTNode *stmt = nullptr;
     Statement(ASTNode *s) : ASTNode(ASTNodeType::Statement), stmt(s) {}
-    ~Statement()
-    {
-        if (stmt)
-            delete stmt;
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "Statement:\n";
@@ -1642,7 +1628,7 @@ public:
             cout << string(indent + 2, ' ') << "Error: Null Statement\n";
         }
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         if (stmt)
         {
@@ -1650,7 +1636,7 @@ public:
         }
         else
         {
-            out << string(indent, '\t') << "/* Error: Null Statement */\n";
+            out.indent(indent) << "/* Error: Null Statement */\n";
         }
     }
 };
@@ -1663,9 +1649,9 @@ public:
     {
         cout << string(indent, ' ') << "EmptyStmt\n";
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << ";\n";
+        out.indent(indent) << ";\n";
     }
 };
 
@@ -1674,21 +1660,14 @@ class BinaryExpr : public ASTNode
 public:
     ASTNode *left = nullptr;
     ASTNode *right = nullptr;
-    string op;
+    Symbol op;
     bool isString = false;
     bool isChar = false;
     ASTNode *funcCallExpr = nullptr;
     BinaryExpr(ASTNode *l, ASTNode *r, ASTNode *funcCall)
         : ASTNode(ASTNodeType::BinaryExpr), left(l), right(r), funcCallExpr(funcCall) {}
-    BinaryExpr(ASTNode *l, ASTNode *r, const string &o, bool isStr = false, bool isCh = false)
+    BinaryExpr(ASTNode *l, ASTNode *r, Symbol o, bool isStr = false, bool isCh = false)
         : ASTNode(ASTNodeType::BinaryExpr), left(l), right(r), op(o), isString(isStr), isChar(isCh) {}
-    ~BinaryExpr()
-    {
-        if (left)
-            delete left;
-        if (right)
-            delete right;
-    }
     void print(int indent = 0) const override
     {
         if (funcCallExpr)
@@ -1721,9 +1700,9 @@ public:
         }*/
     }
 
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t');
+        out.indent(indent);
         if (funcCallExpr)
         {
             funcCallExpr->printToFile(out, indent);
@@ -1759,10 +1738,10 @@ class Literal : public ASTNode
 {
     // 字面量
 public:
-    string value;
+    Symbol value;
     TokenType tokenType;
-    Literal() : ASTNode(ASTNodeType::Literal), value(""), tokenType(TokenType::NONE) {}
-    Literal(const string &val, TokenType lt) : ASTNode(ASTNodeType::Literal), value(val), tokenType(lt) {}
+    Literal() : ASTNode(ASTNodeType::Literal), tokenType(TokenType::NONE) {}
+    Literal(Symbol val, TokenType lt) : ASTNode(ASTNodeType::Literal), value(val), tokenType(lt) {}
     void print(int indent = 0) const override
     {
         if (!value.empty())
@@ -1770,7 +1749,7 @@ public:
             cout << string(indent, ' ') << "Literal: " << value << "\n";
         }
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         out << value;
     }
@@ -1779,18 +1758,10 @@ public:
 class FuncCallExpr : public ASTNode
 {
 public:
-    string functionName;
-    vector<ASTNode *> arguments;
-    FuncCallExpr(const string &fname, const vector<ASTNode *> &args)
+    Symbol functionName;
+    ArenaArray<ASTNode *> arguments;
+    FuncCallExpr(Symbol fname, ArenaArray<ASTNode *> args)
         : ASTNode(ASTNodeType::FuncCallExpr), functionName(fname), arguments(args) {}
-    ~FuncCallExpr()
-    {
-        for (auto arg : arguments)
-        {
-            if (arg)
-                delete arg;
-        }
-    }
     void print(int indent = 0) const override
     {
         cout << string(indent, ' ') << "CallExpr: " << functionName << "\n";
@@ -1807,7 +1778,7 @@ public:
             }
         }
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
         out << functionName << "(";
         for (size_t i = 0; i < arguments.size(); ++i)
@@ -1832,16 +1803,11 @@ public:
 class AssignExpr : public ASTNode
 {
 public:
-    string varName;
-    string operators;
+    Symbol varName;
+    Symbol operators;
     ASTNode *value = nullptr;
-    AssignExpr(const string &vname, const string &op, ASTNode *val)
+    AssignExpr(Symbol vname, Symbol op, ASTNode *val)
         : ASTNode(ASTNodeType::AssignExpr), varName(vname), operators(op), value(val) {}
-    ~AssignExpr()
-    {
-        if (value)
-            delete value;
-    }
 
     void print(int indent = 0) const override
     {
@@ -1857,9 +1823,9 @@ public:
             cout << string(indent + 2, ' ') << "Error: Null Value\n";
         }
     }
-    void printToFile(ostream &out, int indent = 0) const override
+    void printToFile(OutputSink &out, int indent = 0) const override
     {
-        out << string(indent, '\t') << varName << " " << operators << " ";
+        out.indent(indent) << varName << " " << operators << " ";
         if (value)
         {
             value->printToFile(out, 0);
@@ -1870,9 +1836,9 @@ public:
         }
         out << ";\n";
     }
-    void printInForLoop(ostream &out, int indent = 0) const
+    void printInForLoop(OutputSink &out, int indent = 0) const
     {
-        out << string(indent, '\t') << varName << " " << operators << " ";
+        out.indent(indent) << varName << " " << operators << " ";
         if (value)
         {
             value->printToFile(out, 0);
@@ -1882,4 +1848,20 @@ public:
             out << "/* Error: Null Value */";
         }
     }
-};
\ No newline at end of file
+};
+
+// 错误恢复模式下无法解析的一段源码，按原文输出
+class VerbatimNode : public ASTNode
+{
+public:
+    Symbol text;
+    VerbatimNode(Symbol t) : ASTNode(ASTNodeType::Verbatim), text(t) {}
+    void print(int indent = 0) const override
+    {
+        cout << string(indent, ' ') << "Verbatim: " << text << "\n";
+    }
+    void printToFile(OutputSink &out, int indent = 0) const override
+    {
+        out.indent(indent) << text << "\n";
+    }
+};
@@ -0,0 +1,182 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+
+using namespace std;
+
+// 把整块数据写入 fd，处理短写；失败返回 false
+inline bool writeAll(int fd, const char *data, size_t size)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::write(fd, data, size);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0)
+            return false;
+        data += n;
+        size -= (size_t)n;
+    }
+    return true;
+}
+
+// 按顺序把多块数据写入 fd：每次 writev 至多 IOV_MAX 块，处理短写；失败返回 false
+inline bool writevAll(int fd, vector<iovec> &chunks)
+{
+    size_t first = 0;
+    while (first < chunks.size())
+    {
+        if (chunks[first].iov_len == 0)
+        {
+            ++first;
+            continue;
+        }
+        int n = (int)min(chunks.size() - first, (size_t)IOV_MAX);
+        ssize_t written = ::writev(fd, chunks.data() + first, n);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written < 0)
+            return false;
+        // 跳过已写完的块，部分写入的块调整起点
+        size_t left = (size_t)written;
+        while (first < chunks.size() && left >= chunks[first].iov_len)
+            left -= chunks[first++].iov_len;
+        if (left > 0)
+        {
+            chunks[first].iov_base = static_cast<char *>(chunks[first].iov_base) + left;
+            chunks[first].iov_len -= left;
+        }
+    }
+    return true;
+}
+
+// 输出文件：目标是普通文件或尚不存在时，先写同目录下的临时文件，commit() 时 rename 覆盖目标
+// 并发的读者要么看到旧内容，要么看到完整的新内容；未 commit 就放弃时目标保持原样，原文件的权限位会被保留
+// 目标是设备、FIFO 等非普通文件时直接写入目标
+class OutputFile
+{
+private:
+    string path;
+    string tmpPath; // 为空表示直接写入目标
+    int fd_ = -1;
+
+public:
+    OutputFile() {}
+    OutputFile(const OutputFile &) = delete;
+    OutputFile &operator=(const OutputFile &) = delete;
+    ~OutputFile() { discard(); }
+
+    bool open(const string &target)
+    {
+        discard();
+        path = target;
+        struct stat st;
+        bool exists = stat(path.c_str(), &st) == 0;
+        if (exists && !S_ISREG(st.st_mode))
+        {
+            fd_ = ::open(path.c_str(), O_WRONLY | O_TRUNC);
+            return fd_ >= 0;
+        }
+        string tmpl = path + ".tmpXXXXXX";
+        vector<char> buffer(tmpl.begin(), tmpl.end());
+        buffer.push_back('\0');
+        fd_ = mkstemp(buffer.data());
+        if (fd_ < 0)
+            return false;
+        tmpPath = buffer.data();
+        fchmod(fd_, exists ? st.st_mode & 07777 : 0644);
+        return true;
+    }
+    int fd() const { return fd_; }
+
+    // 关闭并替换目标；失败时目标保持原样
+    bool commit()
+    {
+        bool ok = fd_ >= 0 && ::close(fd_) == 0;
+        fd_ = -1;
+        if (!tmpPath.empty())
+        {
+            ok = ok && rename(tmpPath.c_str(), path.c_str()) == 0;
+            if (!ok)
+                unlink(tmpPath.c_str());
+            tmpPath.clear();
+        }
+        return ok;
+    }
+
+    // 放弃已写入的内容：删除临时文件，目标保持原样
+    void discard()
+    {
+        if (fd_ >= 0)
+            ::close(fd_);
+        fd_ = -1;
+        if (!tmpPath.empty())
+            unlink(tmpPath.c_str());
+        tmpPath.clear();
+    }
+};
+
+// 原子地替换文件内容，见 OutputFile
+inline bool writeFileAtomic(const string &path, const char *data, size_t size)
+{
+    OutputFile out;
+    return out.open(path) && writeAll(out.fd(), data, size) && out.commit();
+}
+
+inline bool writeFileAtomic(const string &path, const string &data)
+{
+    return writeFileAtomic(path, data.data(), data.size());
+}
+
+inline bool isDirectory(const string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+inline bool hasSourceExtension(const string &name)
+{
+    size_t dot = name.rfind('.');
+    if (dot == string::npos)
+        return false;
+    string ext = name.substr(dot);
+    return ext == ".c" || ext == ".h";
+}
+
+// 递归收集目录下的 .c/.h 文件，结果按路径排序以保证输出顺序稳定
+// 目录中的符号链接一律跳过：指向上层目录的链接会造成无限递归，-i 替换链接文件时也会把链接换成普通文件
+inline void collectSourceFiles(const string &dir, vector<string> &files)
+{
+    DIR *d = opendir(dir.c_str());
+    if (!d)
+        return;
+    vector<string> found;
+    while (struct dirent *entry = readdir(d))
+    {
+        string name = entry->d_name;
+        if (name == "." || name == "..")
+            continue;
+        string path = dir + "/" + name;
+        struct stat st;
+        if (lstat(path.c_str(), &st) != 0 || S_ISLNK(st.st_mode))
+            continue;
+        if (S_ISDIR(st.st_mode))
+            collectSourceFiles(path, found);
+        else if (hasSourceExtension(name))
+            found.push_back(path);
+    }
+    closedir(d);
+    sort(found.begin(), found.end());
+    files.insert(files.end(), found.begin(), found.end());
+}
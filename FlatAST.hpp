@@ -0,0 +1,776 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cassert>
+#include "ASTNodes.hpp"
+#include "Lexer-Paser.hpp"
+#include "OutputSink.hpp"
+#include "StringPool.hpp"
+
+using namespace std;
+
+// 紧凑 AST 的节点种类；子节点按位置排列，空指针用 None 占位
+enum class FlatKind : uint8_t
+{
+    None,         // 空指针占位，按所在位置输出相应的错误注释
+    Program,      // 子节点：顶层定义...
+    Preprocessor, // text：指令
+    Type,         // text：各类型名依次加空格拼接
+    ExtVarDecl,   // 子节点：Type, VarDecl...
+    LocalVarDecl, // 子节点：Type, VarDecl...
+    VarDecl,      // text：变量名；子节点：Dim..., [初始化]
+    Dim,          // 数组维度；子节点：[大小]
+    FunctionDef,  // text：函数名；子节点：Type, Param..., 函数体
+    FunctionDecl, // 子节点：Type, DeclName...
+    DeclName,     // text：函数名；子节点：Param...
+    Param,        // text：参数名；子节点：Type
+    TypeDef,      // 子节点：Type, Alias...
+    Alias,        // text：别名
+    Compound,     // 子节点：语句...
+    If,           // 子节点：条件, then, [else]
+    While,        // 子节点：条件, 循环体
+    DoWhile,      // 子节点：循环体, 条件
+    For,          // 子节点：初始化, 条件, 增量, 循环体
+    Return,       // 子节点：[表达式]
+    Switch,       // 子节点：表达式, Case..., [Default]
+    Case,         // 子节点：值, 语句...
+    Default,      // 子节点：语句...
+    Break,
+    Continue,
+    Empty,
+    Binary,       // text：运算符；子节点：左, 右（flags 含 CALL 时为函数调用）
+    Literal,      // text：字面量
+    Call,         // text：函数名；子节点：参数...
+    Assign,       // text："变量名 运算符 "；子节点：值
+    InitList      // 子节点：初始化项...
+};
+
+// 结构数组形式的 AST：每个节点只有种类、标志、字符串句柄与两个 32 位下标（第一个子节点、下一个兄弟），共 14 字节
+// 输出用 switch 遍历，与各节点类的 printToFile 逐字节一致
+// 节点 0 是 Program；由于它不会是任何节点的子节点，下标 0 同时表示“没有”
+class FlatAST
+{
+public:
+    static const uint8_t STRING = 1; // Binary：运算符位置是字符串字面量
+    static const uint8_t CHAR = 2;   // Binary：运算符位置是字符常量
+    static const uint8_t CALL = 4;   // Binary：唯一的子节点是函数调用
+
+private:
+    vector<FlatKind> kinds;
+    vector<uint8_t> flags;
+    vector<uint32_t> texts;
+    vector<uint32_t> firstChild;
+    vector<uint32_t> nextSibling;
+    StringPool strings;
+    uint32_t lastItem = 0;
+    string scratch;
+
+    uint32_t add(FlatKind kind, uint32_t text = 0, uint8_t flag = 0)
+    {
+        uint32_t n = (uint32_t)kinds.size();
+        kinds.push_back(kind);
+        flags.push_back(flag);
+        texts.push_back(text);
+        firstChild.push_back(0);
+        nextSibling.push_back(0);
+        return n;
+    }
+    void append(uint32_t parent, uint32_t &last, uint32_t child)
+    {
+        if (last)
+            nextSibling[last] = child;
+        else
+            firstChild[parent] = child;
+        last = child;
+    }
+    uint32_t type(const TypeSpec *spec)
+    {
+        if (!spec)
+            return add(FlatKind::None);
+        scratch.clear();
+        for (const auto &name : spec->typeName)
+        {
+            scratch.append(name.data(), name.size());
+            scratch += ' ';
+        }
+        return add(FlatKind::Type, strings.intern(scratch));
+    }
+    void params(uint32_t parent, uint32_t &last, const ArenaArray<pair<TypeSpec *, Symbol>> &list)
+    {
+        for (const auto &param : list)
+        {
+            uint32_t p = add(FlatKind::Param, strings.intern(param.second));
+            append(parent, last, p);
+            uint32_t none = 0;
+            append(p, none, type(param.first));
+        }
+    }
+    void varDecls(uint32_t n, const ArenaArray<VarDeclNode *> &decls)
+    {
+        uint32_t last = 0;
+        append(n, last, type(decls[0]->typeName));
+        for (const VarDeclNode *decl : decls)
+        {
+            if (!decl)
+            {
+                append(n, last, add(FlatKind::None));
+                continue;
+            }
+            uint32_t v = add(FlatKind::VarDecl, strings.intern(decl->name));
+            append(n, last, v);
+            uint32_t vLast = 0;
+            for (const ASTNode *size : decl->arraySizes)
+            {
+                uint32_t d = add(FlatKind::Dim);
+                append(v, vLast, d);
+                if (size)
+                {
+                    uint32_t none = 0;
+                    append(d, none, lower(size));
+                }
+            }
+            if (decl->init)
+                append(v, vLast, lower(decl->init));
+        }
+    }
+    void list(uint32_t n, uint32_t &last, const ArenaArray<ASTNode *> &nodes)
+    {
+        for (const ASTNode *child : nodes)
+            append(n, last, lower(child));
+    }
+
+    // 把指针形式的子树转换为紧凑形式，返回其根的下标
+    uint32_t lower(const ASTNode *node)
+    {
+        if (!node)
+            return add(FlatKind::None);
+        uint32_t n, last = 0;
+        switch (node->type)
+        {
+        case ASTNodeType::Preprocessor:
+            return add(FlatKind::Preprocessor, strings.intern(static_cast<const Preprocessor *>(node)->directive));
+        case ASTNodeType::ExtVarDecl:
+            n = add(FlatKind::ExtVarDecl);
+            varDecls(n, static_cast<const ExtVarDecl *>(node)->varDecls);
+            return n;
+        case ASTNodeType::LocalVarDecl:
+            n = add(FlatKind::LocalVarDecl);
+            varDecls(n, static_cast<const LocalVarDecl *>(node)->varDecls);
+            return n;
+        case ASTNodeType::FunctionDef:
+        {
+            auto def = static_cast<const FunctionDef *>(node);
+            n = add(FlatKind::FunctionDef, strings.intern(def->functionName));
+            append(n, last, type(def->returnType));
+            params(n, last, def->parameters);
+            append(n, last, lower(def->body));
+            return n;
+        }
+        case ASTNodeType::FunctionDecl:
+        {
+            auto decl = static_cast<const FuncionDeclNode *>(node);
+            n = add(FlatKind::FunctionDecl);
+            append(n, last, type(decl->returnType));
+            for (size_t i = 0; i < decl->functionNames.size(); ++i)
+            {
+                uint32_t name = add(FlatKind::DeclName, strings.intern(decl->functionNames[i]));
+                append(n, last, name);
+                uint32_t nameLast = 0;
+                params(name, nameLast, decl->parameters[i]);
+            }
+            return n;
+        }
+        case ASTNodeType::TypeDef:
+        {
+            auto def = static_cast<const TypeDefNode *>(node);
+            n = add(FlatKind::TypeDef);
+            append(n, last, type(def->typeName));
+            for (const auto &alias : def->alias)
+                append(n, last, add(FlatKind::Alias, strings.intern(alias)));
+            return n;
+        }
+        case ASTNodeType::CompoundStmt:
+            n = add(FlatKind::Compound);
+            list(n, last, static_cast<const CompoundStmt *>(node)->statements);
+            return n;
+        case ASTNodeType::IfStmt:
+        {
+            auto stmt = static_cast<const IfStmt *>(node);
+            n = add(FlatKind::If);
+            append(n, last, lower(stmt->condition));
+            append(n, last, lower(stmt->thenBranch));
+            if (stmt->elseBranch)
+                append(n, last, lower(stmt->elseBranch));
+            return n;
+        }
+        case ASTNodeType::WhileStmt:
+        {
+            auto stmt = static_cast<const WhileStmt *>(node);
+            n = add(FlatKind::While);
+            append(n, last, lower(stmt->condition));
+            append(n, last, lower(stmt->body));
+            return n;
+        }
+        case ASTNodeType::DoWhileStmt:
+        {
+            auto stmt = static_cast<const DoWhileStmt *>(node);
+            n = add(FlatKind::DoWhile);
+            append(n, last, lower(stmt->body));
+            append(n, last, lower(stmt->condition));
+            return n;
+        }
+        case ASTNodeType::ForStmt:
+        {
+            auto stmt = static_cast<const ForStmt *>(node);
+            n = add(FlatKind::For);
+            append(n, last, lower(stmt->init));
+            append(n, last, lower(stmt->condition));
+            append(n, last, lower(stmt->increment));
+            append(n, last, lower(stmt->body));
+            return n;
+        }
+        case ASTNodeType::ReturnStmt:
+        {
+            auto stmt = static_cast<const ReturnStmt *>(node);
+            n = add(FlatKind::Return);
+            if (stmt->expression)
+                append(n, last, lower(stmt->expression));
+            return n;
+        }
+        case ASTNodeType::SwitchStmt:
+        {
+            auto stmt = static_cast<const SwitchStmt *>(node);
+            n = add(FlatKind::Switch);
+            append(n, last, lower(stmt->expression));
+            list(n, last, stmt->cases);
+            if (stmt->defaultCase)
+                append(n, last, lower(stmt->defaultCase));
+            return n;
+        }
+        case ASTNodeType::SwitchCase:
+        {
+            auto stmt = static_cast<const SwitchCase *>(node);
+            n = add(FlatKind::Case);
+            append(n, last, lower(stmt->caseValue));
+            list(n, last, stmt->statements);
+            return n;
+        }
+        case ASTNodeType::DefaultCase:
+            n = add(FlatKind::Default);
+            list(n, last, static_cast<const DefaultCase *>(node)->statements);
+            return n;
+        case ASTNodeType::BreakStmt:
+            return add(FlatKind::Break);
+        case ASTNodeType::ContinueStmt:
+            return add(FlatKind::Continue);
+        case ASTNodeType::EmptyStmt:
+            return add(FlatKind::Empty);
+        case ASTNodeType::BinaryExpr:
+        {
+            auto expr = static_cast<const BinaryExpr *>(node);
+            if (expr->funcCallExpr)
+            {
+                n = add(FlatKind::Binary, 0, CALL);
+                append(n, last, lower(expr->funcCallExpr));
+                return n;
+            }
+            uint8_t flag = (expr->isString ? STRING : 0) | (expr->isChar ? CHAR : 0);
+            n = add(FlatKind::Binary, strings.intern(expr->op), flag);
+            append(n, last, lower(expr->left));
+            append(n, last, lower(expr->right));
+            return n;
+        }
+        case ASTNodeType::Literal:
+            return add(FlatKind::Literal, strings.intern(static_cast<const Literal *>(node)->value));
+        case ASTNodeType::FuncCallExpr:
+        {
+            auto call = static_cast<const FuncCallExpr *>(node);
+            n = add(FlatKind::Call, strings.intern(call->functionName));
+            list(n, last, call->arguments);
+            return n;
+        }
+        case ASTNodeType::AssignExpr:
+        {
+            auto assign = static_cast<const AssignExpr *>(node);
+            scratch.assign(assign->varName.data(), assign->varName.size());
+            scratch += ' ';
+            scratch.append(assign->operators.data(), assign->operators.size());
+            scratch += ' ';
+            n = add(FlatKind::Assign, strings.intern(scratch));
+            append(n, last, lower(assign->value));
+            return n;
+        }
+        case ASTNodeType::VarDeclList:
+            if (auto init = dynamic_cast<const VarInitList *>(node))
+            {
+                n = add(FlatKind::InitList);
+                list(n, last, init->inits);
+                return n;
+            }
+            break;
+        default:
+            break;
+        }
+        assert(!"flat AST: unsupported node type"); // 解析器产生的节点类型都应在上面处理
+        return add(FlatKind::None);
+    }
+
+    // ---- 输出：与 ASTNodes.hpp 中对应类的 printToFile 保持一致 ----
+
+    void text(OutputSink &out, uint32_t n) const
+    {
+        SourceRef s = strings.view(texts[n]);
+        out.write(s.data(), s.size());
+    }
+
+    // VarDecl 列表：ExtVarDecl / LocalVarDecl 共用
+    void printVarDecls(OutputSink &out, uint32_t n, int indent) const
+    {
+        out.indent(indent);
+        uint32_t c = firstChild[n];
+        if (kinds[c] == FlatKind::Type)
+            text(out, c);
+        for (c = nextSibling[c]; c; c = nextSibling[c])
+        {
+            if (kinds[c] == FlatKind::None)
+                out << "/* Error: Null VarDecl */";
+            else
+            {
+                text(out, c);
+                for (uint32_t d = firstChild[c]; d; d = nextSibling[d])
+                {
+                    if (kinds[d] == FlatKind::Dim)
+                    {
+                        out << "[";
+                        if (firstChild[d])
+                            print(out, firstChild[d], 0);
+                        out << "]";
+                    }
+                    else
+                    {
+                        out << " = ";
+                        print(out, d, 0);
+                    }
+                }
+            }
+            if (nextSibling[c])
+                out << ", ";
+        }
+    }
+
+    void printParams(OutputSink &out, uint32_t p) const
+    {
+        for (; p && kinds[p] == FlatKind::Param; p = nextSibling[p])
+        {
+            uint32_t t = firstChild[p];
+            if (kinds[t] == FlatKind::Type)
+            {
+                text(out, t);
+                text(out, p);
+            }
+            else
+                out << "/* Error: Null Parameter Type */";
+            if (nextSibling[p] && kinds[nextSibling[p]] == FlatKind::Param)
+                out << ", ";
+        }
+    }
+
+    // if / while / for 的分支：表达式单独成行并补上分号，其余按原缩进输出
+    void printBranch(OutputSink &out, uint32_t n, int indent, const char *nullMessage) const
+    {
+        if (kinds[n] == FlatKind::None)
+            out << nullMessage;
+        else if (kinds[n] == FlatKind::Binary)
+        {
+            out.indent(indent + 1);
+            print(out, n, 0);
+            out << ";\n";
+        }
+        else
+            print(out, n, indent);
+    }
+
+    void printExpr(OutputSink &out, uint32_t n, const char *nullMessage) const
+    {
+        if (kinds[n] == FlatKind::None)
+            out << nullMessage;
+        else
+            print(out, n, 0);
+    }
+
+    void printStatements(OutputSink &out, uint32_t c, int indent) const
+    {
+        for (; c; c = nextSibling[c])
+        {
+            if (kinds[c] == FlatKind::None)
+                out.indent(indent) << "/* Error: Null Statement */\n";
+            else
+                print(out, c, indent);
+        }
+    }
+
+    // if 条件与分支；else if 链中的后续 if 不输出前导缩进，也不输出末尾空行
+    void printIf(OutputSink &out, uint32_t n, int indent) const
+    {
+        uint32_t cond = firstChild[n];
+        uint32_t then = nextSibling[cond];
+        uint32_t other = nextSibling[then];
+        out << "if (";
+        printExpr(out, cond, "/* Error: Null Condition */");
+        out << ")\n";
+        printBranch(out, then, indent, "{ /* Error: Null Then Branch */ }");
+        if (other)
+        {
+            out.indent(indent) << "else ";
+            if (kinds[other] == FlatKind::If)
+                printIf(out, other, indent);
+            else
+                print(out, other, indent);
+        }
+    }
+
+    void printInForLoop(OutputSink &out, uint32_t n, int indent) const
+    {
+        if (kinds[n] == FlatKind::LocalVarDecl)
+        {
+            printVarDecls(out, n, indent);
+            out << ";";
+        }
+        else if (kinds[n] == FlatKind::Assign)
+        {
+            out.indent(indent);
+            text(out, n);
+            printExpr(out, firstChild[n], "/* Error: Null Value */");
+        }
+    }
+
+    void print(OutputSink &out, uint32_t n, int indent) const
+    {
+        switch (kinds[n])
+        {
+        case FlatKind::Program:
+            out.indent(indent, ' ');
+            for (uint32_t c = firstChild[n]; c; c = nextSibling[c])
+            {
+                if (kinds[c] == FlatKind::None)
+                    out.indent(indent) << "Error: Null ExtDef\n";
+                else
+                    print(out, c, indent);
+            }
+            break;
+        case FlatKind::Preprocessor:
+            out.indent(indent);
+            text(out, n);
+            out << "\n";
+            break;
+        case FlatKind::Type:
+            text(out, n);
+            break;
+        case FlatKind::ExtVarDecl:
+        case FlatKind::LocalVarDecl:
+            printVarDecls(out, n, indent);
+            out << ";\n";
+            break;
+        case FlatKind::FunctionDef:
+        {
+            uint32_t t = firstChild[n];
+            out.indent(indent);
+            if (kinds[t] == FlatKind::Type)
+                text(out, t);
+            text(out, n);
+            out << "(";
+            printParams(out, nextSibling[t]);
+            out << ") ";
+            uint32_t body = nextSibling[t];
+            while (kinds[body] == FlatKind::Param)
+                body = nextSibling[body];
+            if (kinds[body] == FlatKind::None)
+                out << "{ /* Error: Null Body */ }\n";
+            else
+                print(out, body, indent);
+            break;
+        }
+        case FlatKind::FunctionDecl:
+        {
+            uint32_t t = firstChild[n];
+            for (uint32_t name = nextSibling[t]; name; name = nextSibling[name])
+            {
+                out.indent(indent);
+                if (kinds[t] == FlatKind::Type)
+                    text(out, t);
+                text(out, name);
+                out << "(";
+                printParams(out, firstChild[name]);
+                out << ");\n";
+            }
+            break;
+        }
+        case FlatKind::TypeDef:
+        {
+            uint32_t t = firstChild[n];
+            out.indent(indent) << "typedef ";
+            if (kinds[t] == FlatKind::Type)
+                text(out, t);
+            for (uint32_t alias = nextSibling[t]; alias; alias = nextSibling[alias])
+            {
+                text(out, alias);
+                if (nextSibling[alias])
+                    out << ", ";
+            }
+            out << ";\n";
+            break;
+        }
+        case FlatKind::Compound:
+            out.indent(indent) << "{\n";
+            for (uint32_t c = firstChild[n]; c; c = nextSibling[c])
+            {
+                if (kinds[c] == FlatKind::None)
+                    out.indent(indent + 1) << "/* Error: Null Statement */\n";
+                else
+                {
+                    print(out, c, indent + 1);
+                    if (kinds[c] == FlatKind::Binary)
+                        out << ";\n";
+                }
+            }
+            out.indent(indent) << "}\n";
+            break;
+        case FlatKind::If:
+            out.indent(indent);
+            printIf(out, n, indent);
+            out << "\n";
+            break;
+        case FlatKind::While:
+        {
+            uint32_t cond = firstChild[n];
+            out.indent(indent) << "while (";
+            printExpr(out, cond, "/* Error: Null Condition */");
+            out << ")\n";
+            printBranch(out, nextSibling[cond], indent, "{ /* Error: Null Body */ }");
+            out << "\n";
+            break;
+        }
+        case FlatKind::DoWhile:
+        {
+            uint32_t body = firstChild[n];
+            out.indent(indent) << "do ";
+            if (kinds[body] == FlatKind::None)
+                out << "{ /* Error: Null Body */ }";
+            else
+                print(out, body, indent);
+            out.indent(indent) << "while (";
+            printExpr(out, nextSibling[body], "/* Error: Null Condition */");
+            out << ");\n";
+            break;
+        }
+        case FlatKind::For:
+        {
+            uint32_t init = firstChild[n];
+            uint32_t cond = nextSibling[init];
+            uint32_t inc = nextSibling[cond];
+            out.indent(indent) << "for (";
+            if (kinds[init] == FlatKind::None)
+                out << "/* Error: Null Initialization */";
+            else if (kinds[init] == FlatKind::Binary)
+            {
+                print(out, init, 0);
+                out << "; ";
+            }
+            else if (kinds[init] == FlatKind::LocalVarDecl)
+            {
+                printInForLoop(out, init, 0);
+                out << " ";
+            }
+            printExpr(out, cond, "/* Error: Null Condition */");
+            out << "; ";
+            if (kinds[inc] == FlatKind::None)
+                out << "/* Error: Null Increment */";
+            else if (kinds[inc] == FlatKind::Assign)
+                printInForLoop(out, inc, 0);
+            else
+                print(out, inc, 0);
+            out << ")\n";
+            printBranch(out, nextSibling[inc], indent, "{ /* Error: Null Body */ }");
+            out << "\n";
+            break;
+        }
+        case FlatKind::Return:
+            out.indent(indent) << "return";
+            if (firstChild[n])
+            {
+                out << " ";
+                print(out, firstChild[n], 0);
+            }
+            out << ";\n";
+            break;
+        case FlatKind::Switch:
+        {
+            uint32_t expr = firstChild[n];
+            out.indent(indent) << "switch (";
+            printExpr(out, expr, "/* Error: Null Expression */");
+            out << ") {\n";
+            for (uint32_t c = nextSibling[expr]; c; c = nextSibling[c])
+            {
+                if (kinds[c] == FlatKind::None)
+                    out.indent(indent + 1) << "/* Error: Null Case Statement */\n";
+                else
+                    print(out, c, indent + 1);
+            }
+            out.indent(indent) << "}\n";
+            break;
+        }
+        case FlatKind::Case:
+        {
+            uint32_t value = firstChild[n];
+            out.indent(indent) << "case ";
+            printExpr(out, value, "/* Error: Null Case Value */");
+            out << ":\n";
+            printStatements(out, nextSibling[value], indent + 1);
+            break;
+        }
+        case FlatKind::Default:
+            out.indent(indent) << "default:\n";
+            printStatements(out, firstChild[n], indent + 1);
+            break;
+        case FlatKind::Break:
+            out.indent(indent) << "break;\n";
+            break;
+        case FlatKind::Continue:
+            out.indent(indent) << "continue;\n";
+            break;
+        case FlatKind::Empty:
+            out.indent(indent) << ";\n";
+            break;
+        case FlatKind::Binary:
+        {
+            out.indent(indent);
+            uint32_t left = firstChild[n];
+            if (flags[n] & CALL)
+            {
+                print(out, left, indent);
+                break;
+            }
+            if (kinds[left] != FlatKind::None)
+                print(out, left, indent);
+            if (texts[n])
+            {
+                if (flags[n] & STRING)
+                {
+                    out << "\"";
+                    text(out, n);
+                    out << "\" ";
+                }
+                else if (flags[n] & CHAR)
+                {
+                    out << "'";
+                    text(out, n);
+                    out << "' ";
+                }
+                else
+                {
+                    text(out, n);
+                    out << " ";
+                }
+            }
+            uint32_t right = nextSibling[left];
+            if (kinds[right] != FlatKind::None)
+                print(out, right, indent);
+            break;
+        }
+        case FlatKind::Literal:
+            text(out, n);
+            break;
+        case FlatKind::Call:
+            text(out, n);
+            out << "(";
+            for (uint32_t c = firstChild[n]; c; c = nextSibling[c])
+            {
+                printExpr(out, c, "/* Error: Null Argument */");
+                if (nextSibling[c])
+                    out << ", ";
+            }
+            out << ")";
+            break;
+        case FlatKind::Assign:
+            out.indent(indent);
+            text(out, n);
+            printExpr(out, firstChild[n], "/* Error: Null Value */");
+            out << ";\n";
+            break;
+        case FlatKind::InitList:
+            out << "{ ";
+            for (uint32_t c = firstChild[n]; c; c = nextSibling[c])
+            {
+                printExpr(out, c, "/* Error: Null Initializer */");
+                if (nextSibling[c])
+                    out << ", ";
+            }
+            out << " }";
+            break;
+        default:
+            break;
+        }
+    }
+
+public:
+    FlatAST() { clear(); }
+
+    // 清空并只保留 Program 根节点
+    void clear()
+    {
+        kinds.clear();
+        flags.clear();
+        texts.clear();
+        firstChild.clear();
+        nextSibling.clear();
+        strings = StringPool();
+        add(FlatKind::Program);
+        lastItem = 0;
+    }
+
+    // 把一个顶层定义转换后接到 Program 之后；转换完成后指针子树即可释放
+    void appendItem(const ASTNode *item)
+    {
+        uint32_t n = lower(item);
+        append(0, lastItem, n);
+    }
+
+    void print(OutputSink &out) const { print(out, 0, 0); }
+
+    size_t nodeCount() const { return kinds.size(); }
+    // 节点数组与字符串池占用的内存字节数
+    size_t bytes() const
+    {
+        return kinds.capacity() * sizeof(FlatKind) + flags.capacity() + texts.capacity() * sizeof(uint32_t) +
+               firstChild.capacity() * sizeof(uint32_t) + nextSibling.capacity() * sizeof(uint32_t) + strings.bytes();
+    }
+};
+
+// 解析 source 并直接生成紧凑 AST：每解析完一个顶层定义就转换并释放其指针节点，
+// 任何时刻只有一个顶层定义的指针子树存在。语法错误时返回 false，错误信息写入 error
+// counters 非空时统计词法分析耗时，结束时写入词法计数（--stats 用）
+inline bool parseFlat(const SourceBuffer &source, FlatAST &tree, string &error, LexerCounters *counters = nullptr)
+{
+    ASTArena scratch;
+    Parser parser(source, &scratch);
+    if (counters)
+        parser.timeLexer();
+    tree.clear();
+    bool ok = true;
+    while (!parser.atEnd())
+    {
+        ASTNode *item = parser.topLevelItem();
+        if (parser.failed())
+        {
+            error = parser.error().message;
+            ok = false;
+            break;
+        }
+        tree.appendItem(item);
+        scratch.reset();
+    }
+    if (counters)
+        *counters = parser.lexerCounters();
+    return ok;
+}
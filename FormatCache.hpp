@@ -0,0 +1,131 @@
+#pragma once
+#include <string>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <sys/stat.h>
+#include "SourceBuffer.hpp"
+#include "FileUtil.hpp"
+
+using namespace std;
+
+// 格式化器版本；改变输出的提交需要修改它，旧的缓存条目随之失效
+const char *const FORMATTER_VERSION = "cformatter-2";
+
+// 64 位非加密哈希，每次处理 8 字节
+inline uint64_t hashBytes(const char *data, size_t size, uint64_t seed)
+{
+    const uint64_t m = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = seed ^ (size * m);
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t k;
+        memcpy(&k, data + i, 8);
+        k *= 0xBF58476D1CE4E5B9ULL;
+        k ^= k >> 31;
+        h = (h ^ k) * m;
+        h ^= h >> 29;
+    }
+    uint64_t tail = 0;
+    memcpy(&tail, data + i, size - i);
+    h = (h ^ (tail * 0x94D049BB133111EBULL)) * m;
+    h ^= h >> 32;
+    h *= 0xBF58476D1CE4E5B9ULL;
+    h ^= h >> 29;
+    return h;
+}
+
+// 以 输入内容 + 格式化器版本 + 选项 为键的磁盘缓存
+// 每个条目一个文件，内容为格式化结果或“已是格式化结果”标记
+// 条目通过临时文件 + rename 原子写入，多个并行进程共用同一目录是安全的
+class FormatCache
+{
+public:
+    enum class Lookup
+    {
+        Miss,      // 没有可用条目
+        Formatted, // 条目中是格式化结果
+        Unchanged  // 输入本身就是格式化结果
+    };
+
+private:
+    static const size_t HEADER_SIZE = 16; // magic(4) kind(4) sourceSize(8)
+    string dir;
+    string salt; // 版本与选项
+
+    string entryPath(const char *data, size_t size) const
+    {
+        uint64_t saltHash = hashBytes(salt.data(), salt.size(), 0);
+        uint64_t h1 = hashBytes(data, size, saltHash);
+        uint64_t h2 = hashBytes(data, size, saltHash ^ 0x5851F42D4C957F2DULL);
+        char name[33];
+        snprintf(name, sizeof(name), "%016llx%016llx", (unsigned long long)h1, (unsigned long long)h2);
+        return dir + "/" + name;
+    }
+
+public:
+    // options 描述影响输出的全部选项
+    FormatCache(const string &directory, const string &options)
+        : dir(directory), salt(string(FORMATTER_VERSION) + '\0' + options) {}
+
+    // 创建缓存目录（含父目录）
+    bool prepare() const
+    {
+        for (size_t pos = 1; pos <= dir.size(); ++pos)
+        {
+            if (pos == dir.size() || dir[pos] == '/')
+            {
+                string prefix = dir.substr(0, pos);
+                if (mkdir(prefix.c_str(), 0755) != 0 && errno != EEXIST)
+                    return false;
+            }
+        }
+        return isDirectory(dir);
+    }
+
+    // 命中 Formatted 时把结果写入 output
+    Lookup lookup(const SourceBuffer &source, string &output) const
+    {
+        SourceBuffer entry;
+        if (!entry.open(entryPath(source.data(), source.size())) || entry.size() < HEADER_SIZE)
+            return Lookup::Miss;
+        const char *p = entry.data();
+        uint64_t sourceSize;
+        memcpy(&sourceSize, p + 8, 8);
+        if (memcmp(p, "CFC1", 4) != 0 || sourceSize != source.size())
+            return Lookup::Miss;
+        if (p[4] == 'U' && entry.size() == HEADER_SIZE)
+            return Lookup::Unchanged;
+        if (p[4] != 'F')
+            return Lookup::Miss;
+        output.assign(p + HEADER_SIZE, entry.size() - HEADER_SIZE);
+        return Lookup::Formatted;
+    }
+
+    // 记录 source 的格式化结果；与输入相同时只写标记。写入失败不影响格式化本身
+    void store(const SourceBuffer &source, const string &output) const
+    {
+        bool unchanged = output.size() == source.size() && memcmp(output.data(), source.data(), output.size()) == 0;
+        writeEntry(source, unchanged ? nullptr : &output);
+    }
+
+    // 记录 source 已是格式化结果（--check 中确认一致时使用，无需完整的输出）
+    void markFormatted(const SourceBuffer &source) const
+    {
+        writeEntry(source, nullptr);
+    }
+
+private:
+    void writeEntry(const SourceBuffer &source, const string *output) const
+    {
+        string entry("CFC1", 4);
+        entry.append(output ? "F\0\0\0" : "U\0\0\0", 4);
+        uint64_t sourceSize = source.size();
+        entry.append(reinterpret_cast<const char *>(&sourceSize), 8);
+        if (output)
+            entry += *output;
+        writeFileAtomic(entryPath(source.data(), source.size()), entry);
+    }
+};
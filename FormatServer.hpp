@@ -0,0 +1,326 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include <cstring>
+#include <csignal>
+#include <cerrno>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "FileUtil.hpp"
+#include "Formatter.hpp"
+#include "Incremental.hpp"
+
+using namespace std;
+
+// 本地套接字协议（所有整数均为网络字节序）
+//   请求：u8 op | u32 pathLen | u32 sourceLen | path | source
+//   响应：u8 status | u32 bodyLen | body
+// op 目前只有 OP_FORMAT；status 为 STATUS_OK 时 body 是格式化结果，否则是错误信息
+// 一个连接上可以依次发送多个请求
+namespace wire
+{
+    const uint8_t OP_FORMAT = 'F';
+    const uint8_t STATUS_OK = 0;
+    const uint8_t STATUS_ERROR = 1;
+    const uint32_t MAX_PATH = 4096;
+    const uint32_t MAX_SOURCE = 1u << 30;
+
+    inline void putU32(char *p, uint32_t v)
+    {
+        p[0] = (char)(v >> 24);
+        p[1] = (char)(v >> 16);
+        p[2] = (char)(v >> 8);
+        p[3] = (char)v;
+    }
+
+    inline uint32_t getU32(const char *p)
+    {
+        const unsigned char *u = reinterpret_cast<const unsigned char *>(p);
+        return ((uint32_t)u[0] << 24) | ((uint32_t)u[1] << 16) | ((uint32_t)u[2] << 8) | u[3];
+    }
+
+    // 读满 size 字节；出错或对端提前关闭时返回 false
+    inline bool readAll(int fd, char *data, size_t size)
+    {
+        size_t got = 0;
+        while (got < size)
+        {
+            ssize_t n = ::read(fd, data + got, size - got);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            got += (size_t)n;
+        }
+        return true;
+    }
+
+    inline bool sendResponse(int fd, uint8_t status, const char *body, size_t size)
+    {
+        char header[5];
+        header[0] = (char)status;
+        putU32(header + 1, (uint32_t)size);
+        return writeAll(fd, header, sizeof(header)) && writeAll(fd, body, size);
+    }
+
+    inline int connectTo(const string &socketPath)
+    {
+        sockaddr_un addr;
+        if (socketPath.size() >= sizeof(addr.sun_path))
+            return -1;
+        int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0)
+            return -1;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0)
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+}
+
+// 收到终止信号时删除套接字文件；信号处理函数中只能使用 async-signal-safe 的调用
+static char serverSocketPath[sizeof(sockaddr_un().sun_path)];
+extern "C" inline void onServerSignal(int sig)
+{
+    unlink(serverSocketPath);
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+// 常驻的格式化服务：进程与静态表只初始化一次，arena 在请求之间复用
+// 每个连接由独立的线程处理，空闲的客户端不会阻塞其他连接；格式化本身由 formatLock 串行化
+class FormatServer
+{
+private:
+    string socketPath;
+    int listenFd = -1;
+    static const size_t MAX_DOCUMENTS = 32;
+    static const int IDLE_TIMEOUT_SECONDS = 60; // 连接上超过这么久没有新请求就关闭
+    mutex formatLock; // 保护 arena 与 documents
+    ASTArena arena;   // 每个请求前 reset()，内存块保留
+    // 按路径保留最近格式化过的文件，同一文件再次提交时只重新解析改动的顶层定义
+    struct Document
+    {
+        IncrementalDocument doc;
+        size_t lastUse = 0;
+    };
+    map<string, unique_ptr<Document>> documents;
+    size_t useClock = 0;
+    // 仍在处理中的连接数，run() 返回前等待它们结束
+    mutex connectionLock;
+    condition_variable connectionDone;
+    size_t activeConnections = 0;
+
+    Document &documentFor(const string &path)
+    {
+        unique_ptr<Document> &slot = documents[path];
+        if (!slot)
+        {
+            if (documents.size() > MAX_DOCUMENTS)
+            {
+                auto oldest = documents.end();
+                for (auto it = documents.begin(); it != documents.end(); ++it)
+                {
+                    if (it->second && (oldest == documents.end() || it->second->lastUse < oldest->second->lastUse))
+                        oldest = it;
+                }
+                if (oldest != documents.end())
+                    documents.erase(oldest);
+            }
+            slot.reset(new Document());
+        }
+        slot->lastUse = ++useClock;
+        return *slot;
+    }
+
+    // 格式化一个请求；有路径的文件走增量文档，标准输入等匿名内容完整解析
+    // 语法错误时返回 false，错误信息写入 error
+    bool format(const string &path, const SourceBuffer &source, string &response, string &error)
+    {
+        lock_guard<mutex> guard(formatLock);
+        if (path.empty() || path == "-")
+        {
+            arena.reset();
+            return formatToString(source, arena, response, error);
+        }
+        IncrementalDocument &doc = documentFor(path).doc;
+        if (!doc.update(source.data(), source.size()))
+        {
+            error = doc.error();
+            return false;
+        }
+        StringSink sink(response);
+        doc.print(sink);
+        return true;
+    }
+
+    // 处理一个连接上的全部请求，连接出错、超时或对端关闭时返回
+    void serveConnection(int fd)
+    {
+        timeval timeout;
+        timeout.tv_sec = IDLE_TIMEOUT_SECONDS;
+        timeout.tv_usec = 0;
+        setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+        string request;  // 请求中的路径与源码
+        string response; // 格式化结果或错误信息
+        char header[9];
+        while (true)
+        {
+            if (!wire::readAll(fd, header, sizeof(header)))
+                return;
+            uint8_t op = (uint8_t)header[0];
+            uint32_t pathLen = wire::getU32(header + 1);
+            uint32_t sourceLen = wire::getU32(header + 5);
+            if (pathLen > wire::MAX_PATH || sourceLen > wire::MAX_SOURCE)
+            {
+                const char *message = "Error: request too large";
+                wire::sendResponse(fd, wire::STATUS_ERROR, message, strlen(message));
+                return;
+            }
+            request.resize((size_t)pathLen + sourceLen);
+            if (!wire::readAll(fd, &request[0], request.size()))
+                return;
+            string path = request.substr(0, pathLen);
+            if (op != wire::OP_FORMAT)
+            {
+                string message = "Error: unknown request op " + to_string((int)op);
+                if (!wire::sendResponse(fd, wire::STATUS_ERROR, message.data(), message.size()))
+                    return;
+                continue;
+            }
+            SourceBuffer source(request.data() + pathLen, sourceLen);
+            response.clear();
+            string error;
+            // 错误信息与本地格式化时输出的完全一致
+            bool ok = format(path, source, response, error);
+            if (!ok)
+                response.swap(error);
+            if (!wire::sendResponse(fd, ok ? wire::STATUS_OK : wire::STATUS_ERROR, response.data(), response.size()))
+                return;
+        }
+    }
+
+public:
+    explicit FormatServer(const string &path) : socketPath(path) {}
+    FormatServer(const FormatServer &) = delete;
+    FormatServer &operator=(const FormatServer &) = delete;
+    ~FormatServer()
+    {
+        if (listenFd >= 0)
+        {
+            ::close(listenFd);
+            unlink(socketPath.c_str());
+        }
+    }
+
+    // 创建并监听套接字；已存在的同名套接字文件会被替换
+    bool listen(string &error)
+    {
+        sockaddr_un addr;
+        if (socketPath.size() >= sizeof(addr.sun_path))
+        {
+            error = "Error: socket path too long: " + socketPath;
+            return false;
+        }
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenFd < 0)
+        {
+            error = string("Error: socket: ") + strerror(errno);
+            return false;
+        }
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        memcpy(addr.sun_path, socketPath.c_str(), socketPath.size() + 1);
+        unlink(socketPath.c_str());
+        // 套接字文件只允许属主连接：bind 时按 umask 创建，之后再改权限会留下竞争窗口
+        mode_t oldMask = umask(0077);
+        bool bound = ::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) == 0;
+        umask(oldMask);
+        if (!bound || ::listen(listenFd, 64) != 0)
+        {
+            error = "Error: could not listen on " + socketPath + ": " + strerror(errno);
+            ::close(listenFd);
+            listenFd = -1;
+            return false;
+        }
+        return true;
+    }
+
+    // 为每个连接启动一个线程处理，直到 accept 失败；返回前等待已接受的连接处理完
+    void run()
+    {
+        signal(SIGPIPE, SIG_IGN);
+        memcpy(serverSocketPath, socketPath.c_str(), socketPath.size() + 1);
+        signal(SIGINT, onServerSignal);
+        signal(SIGTERM, onServerSignal);
+        while (true)
+        {
+            int fd = ::accept(listenFd, nullptr, nullptr);
+            if (fd < 0)
+            {
+                if (errno == EINTR || errno == ECONNABORTED)
+                    continue;
+                break;
+            }
+            {
+                lock_guard<mutex> guard(connectionLock);
+                ++activeConnections;
+            }
+            thread([this, fd]()
+                   {
+                       serveConnection(fd);
+                       ::close(fd);
+                       lock_guard<mutex> guard(connectionLock);
+                       if (--activeConnections == 0)
+                           connectionDone.notify_all();
+                   })
+                .detach();
+        }
+        unique_lock<mutex> guard(connectionLock);
+        connectionDone.wait(guard, [this]() { return activeConnections == 0; });
+    }
+};
+
+// 客户端：把 source 交给服务端格式化
+// 返回 -1 表示无法与服务端通信（调用者可退回本地格式化），0 表示成功，1 表示服务端报告错误（信息在 output 中）
+inline int formatViaServer(const string &socketPath, const string &path, const SourceBuffer &source, string &output)
+{
+    if (path.size() > wire::MAX_PATH || source.size() > wire::MAX_SOURCE)
+        return -1;
+    int fd = wire::connectTo(socketPath);
+    if (fd < 0)
+        return -1;
+    signal(SIGPIPE, SIG_IGN);
+    char header[9];
+    header[0] = (char)wire::OP_FORMAT;
+    wire::putU32(header + 1, (uint32_t)path.size());
+    wire::putU32(header + 5, (uint32_t)source.size());
+    char reply[5];
+    bool ok = writeAll(fd, header, sizeof(header)) && writeAll(fd, path.data(), path.size()) &&
+              writeAll(fd, source.data(), source.size()) && wire::readAll(fd, reply, sizeof(reply));
+    if (ok)
+    {
+        output.resize(wire::getU32(reply + 1));
+        ok = wire::readAll(fd, &output[0], output.size());
+    }
+    ::close(fd);
+    if (!ok)
+        return -1;
+    return (uint8_t)reply[0] == wire::STATUS_OK ? 0 : 1;
+}
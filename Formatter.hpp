@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include "SourceBuffer.hpp"
+#include "Lexer-Paser.hpp"
+#include "OutputSink.hpp"
+
+using namespace std;
+
+// 把一段源码格式化后追加到 output；语法错误时返回 false，错误信息写入 error
+// 节点分配在调用者提供的 arena 中，调用者可在多次格式化之间 reset() 复用
+inline bool formatToString(const SourceBuffer &source, ASTArena &arena, string &output, string &error)
+{
+    Parser parser(source, &arena);
+    ASTNode *root = parser.program();
+    if (parser.failed())
+    {
+        error = parser.error().message;
+        return false;
+    }
+    StringSink sink(output);
+    if (root)
+        root->printToFile(sink);
+    return true;
+}
+
+// 判断 source 是否已是格式化结果：逐个顶层定义解析并输出，直接与原文比较，不保存也不写出
+// 第一处不一致后不再解析与输出，之后的语法错误也不再报告
+// 不一致时 *firstDifference 为第一个不同字节在原文中的位置；语法错误时返回 false，错误信息写入 error
+inline bool isFormatted(const SourceBuffer &source, ASTArena &arena, string &error, size_t *firstDifference = nullptr)
+{
+    Parser parser(source, &arena);
+    CompareSink sink(source.data(), source.size());
+    // 与 ProgramNode::printToFile 的输出相同：各顶层定义依次输出，缩进为 0
+    while (!parser.atEnd() && sink.good())
+    {
+        ASTNode *item = parser.topLevelItem();
+        if (parser.failed())
+        {
+            error = parser.error().message;
+            return false;
+        }
+        item->printToFile(sink);
+        sink.flush(); // 每个定义输出后立即比较
+    }
+    if (sink.matches())
+        return true;
+    if (firstDifference)
+        *firstDifference = sink.firstDifference();
+    return false;
+}
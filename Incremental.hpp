@@ -0,0 +1,209 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include "SourceBuffer.hpp"
+#include "Lexer-Paser.hpp"
+#include "OutputSink.hpp"
+
+using namespace std;
+
+// 增量格式化的文档：保留上一次的源码、各顶层定义的范围、子树与格式化结果
+// 编辑后只重新扫描、解析受影响的顶层定义，其余定义的子树与输出直接复用
+// 解析器在顶层定义之间没有状态，且 ProgramNode 的输出就是各定义输出的拼接，因此复用是精确的
+class IncrementalDocument
+{
+private:
+    struct Item
+    {
+        size_t begin;     // 在源码中的起点（第一个定义为 0，覆盖前导空白）
+        size_t scanLimit; // 解析该定义时词法分析读取到的最远位置（不含）
+        size_t nodes;     // 该定义占用的节点数
+        ASTNode *node;
+        string formatted;
+    };
+
+    string text;
+    vector<Item> items;
+    ASTArena arena;
+    size_t liveNodes = 0;
+    bool valid = false;
+    size_t lastReparsed = 0; // 最近一次更新重新解析的定义数
+    string lastError;        // 最近一次失败的语法错误
+
+    // 计算 offset 处的行号与列数（供错误信息使用）
+    void positionOf(size_t offset, int &line, int &column) const
+    {
+        const char *base = text.data();
+        line = 1 + (int)count(base, base + offset, '\n');
+        const char *lineStart = base + offset;
+        while (lineStart != base && lineStart[-1] != '\n')
+            --lineStart;
+        column = (int)(base + offset - lineStart);
+    }
+
+    // 从 offset 开始解析，直到源码结束，或下一个定义的起点与 resync 中的某个旧起点重合
+    // 重合时 hit 为该旧定义的下标（调用者复用它及其之后的定义），否则为 resync.size()
+    // resync 中的起点已换算为新坐标且按升序排列；语法错误时返回 false，错误信息记入 lastError
+    bool parseFrom(size_t offset, size_t minResync, const vector<size_t> &resync, vector<Item> &parsed, size_t &hit)
+    {
+        int line, column;
+        positionOf(offset, line, column);
+        SourceBuffer view(text.data() + offset, text.size() - offset);
+        Parser parser(view, line, column, &arena);
+        size_t next = 0;
+        bool first = true;
+        while (!parser.atEnd())
+        {
+            size_t begin = first && offset == 0 ? 0 : (size_t)(parser.itemStart() - text.data());
+            first = false;
+            size_t before = arena.nodeCount();
+            Item item;
+            item.begin = begin;
+            item.node = parser.topLevelItem();
+            if (parser.failed())
+            {
+                lastError = parser.error().message;
+                return false;
+            }
+            item.scanLimit = (size_t)(parser.scanLimit() - text.data());
+            item.nodes = arena.nodeCount() - before;
+            StringSink sink(item.formatted);
+            item.node->printToFile(sink);
+            sink.flush();
+            parsed.push_back(std::move(item));
+
+            size_t start = (size_t)(parser.itemStart() - text.data());
+            if (start < minResync)
+                continue;
+            while (next < resync.size() && resync[next] < start)
+                ++next;
+            if (next < resync.size() && resync[next] == start)
+            {
+                hit = next;
+                return true;
+            }
+        }
+        hit = resync.size();
+        return true;
+    }
+
+public:
+    // 完整解析；语法错误时返回 false，文档变为无效，错误信息见 error()
+    bool reset(const char *data, size_t size)
+    {
+        valid = false;
+        items.clear();
+        arena.reset();
+        liveNodes = 0;
+        text.assign(data, size);
+        vector<size_t> none;
+        size_t hit;
+        if (!parseFrom(0, 0, none, items, hit))
+            return false;
+        for (const auto &item : items)
+            liveNodes += item.nodes;
+        lastReparsed = items.size();
+        valid = true;
+        return true;
+    }
+
+    // 用新的完整内容更新文档：与旧内容比较出唯一的编辑区间后增量解析
+    bool update(const char *data, size_t size)
+    {
+        if (!valid)
+            return reset(data, size);
+        size_t prefix = 0, limit = min(size, text.size());
+        while (prefix < limit && text[prefix] == data[prefix])
+            ++prefix;
+        size_t suffix = 0;
+        while (suffix < limit - prefix && text[text.size() - 1 - suffix] == data[size - 1 - suffix])
+            ++suffix;
+        return applyEdit(prefix, text.size() - prefix - suffix, data + prefix, size - prefix - suffix);
+    }
+
+    // 把 [offset, offset + removed) 替换为 inserted；语法错误时返回 false
+    bool applyEdit(size_t offset, size_t removed, const char *inserted, size_t insertedSize)
+    {
+        if (!valid || items.empty() || offset + removed > text.size())
+        {
+            string updated = text;
+            if (offset + removed <= updated.size())
+                updated.replace(offset, removed, inserted, insertedSize);
+            return reset(updated.data(), updated.size());
+        }
+        if (removed == 0 && insertedSize == 0)
+        {
+            lastReparsed = 0;
+            return true;
+        }
+        // 第一个受影响的定义：其词法分析读取范围触及编辑起点
+        size_t first = 0;
+        while (first + 1 < items.size() && items[first].scanLimit < offset)
+            ++first;
+        size_t oldEditEnd = offset + removed;
+        ptrdiff_t delta = (ptrdiff_t)insertedSize - (ptrdiff_t)removed;
+
+        valid = false; // 解析失败时保持无效，下一次更新会完整解析
+        text.replace(offset, removed, inserted, insertedSize);
+
+        // 编辑区间之后的旧定义起点，换算为新坐标
+        vector<size_t> resync;
+        size_t firstAfter = first + 1;
+        while (firstAfter < items.size() && items[firstAfter].begin < oldEditEnd)
+            ++firstAfter;
+        for (size_t i = firstAfter; i < items.size(); ++i)
+            resync.push_back((size_t)((ptrdiff_t)items[i].begin + delta));
+
+        vector<Item> parsed;
+        size_t hit;
+        if (!parseFrom(items[first].begin, offset + insertedSize, resync, parsed, hit))
+            return false;
+        lastReparsed = parsed.size();
+
+        size_t removedNodes = 0;
+        for (size_t i = first; i < firstAfter + hit; ++i)
+            removedNodes += items[i].nodes;
+        for (const auto &item : parsed)
+            liveNodes += item.nodes;
+        liveNodes -= removedNodes;
+
+        vector<Item> merged;
+        merged.reserve(first + parsed.size() + (resync.size() - hit));
+        for (size_t i = 0; i < first; ++i)
+            merged.push_back(std::move(items[i]));
+        for (auto &item : parsed)
+            merged.push_back(std::move(item));
+        for (size_t i = firstAfter + hit; i < items.size(); ++i)
+        {
+            items[i].begin = (size_t)((ptrdiff_t)items[i].begin + delta);
+            items[i].scanLimit = (size_t)((ptrdiff_t)items[i].scanLimit + delta);
+            merged.push_back(std::move(items[i]));
+        }
+        items.swap(merged);
+        valid = true;
+
+        // 被替换的子树仍留在 arena 中；垃圾过多时整体重建一次
+        if (arena.nodeCount() > 2 * liveNodes + 4096)
+        {
+            string current;
+            current.swap(text);
+            return reset(current.data(), current.size());
+        }
+        return true;
+    }
+
+    // 输出整个文档的格式化结果
+    void print(OutputSink &out) const
+    {
+        for (const auto &item : items)
+            out.write(item.formatted.data(), item.formatted.size());
+    }
+
+    bool isValid() const { return valid; }
+    const string &error() const { return lastError; }
+    size_t itemCount() const { return items.size(); }
+    size_t reparsedItems() const { return lastReparsed; }
+    const string &source() const { return text; }
+};
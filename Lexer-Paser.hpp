@@ -1,25 +1,42 @@
+#pragma once
 #include <iostream>
 #include <string>
 #include <cctype>
 #include <vector>
 #include <algorithm>
-#include <stack>
+#include <chrono>
 #include <unordered_map>
+#include <cstring>
+#include <cstddef>
+#include <cstdint>
+#include <cassert>
 #include "ASTNodes.hpp"
+#include "SourceBuffer.hpp"
 
 using namespace std;
 
+// lexeme 只是指向源码缓冲区的引用，复制 Token 不会分配内存
 struct Token
 {
     TokenType type;
-    string lexeme;
+    bool unknownChar = false; // 无法识别的字符产生的 ERROR 记号（其余 ERROR 是未结束的字符常量、字符串、注释或错误的数字后缀）
+    SourceRef lexeme;
     int line;
     int column;
 
-    Token(TokenType t, const std::string &l, int ln, int col)
+    Token() : type(TokenType::NONE), line(0), column(0) {}
+    Token(TokenType t, SourceRef l, int ln, int col)
         : type(t), lexeme(l), line(ln), column(col) {}
 };
 
+// 一条词法或语法错误；message 是完整的错误信息，含行号与列号
+struct Diagnostic
+{
+    int line;
+    int column;
+    string message;
+};
+
 static const unordered_map<string, TokenType> keywordMap = {
     {"int", TokenType::INT},
     {"long", TokenType::LONG},
@@ -55,6 +72,102 @@ static const unordered_map<string, TokenType> keywordMap = {
     {"undef", TokenType::UNDEF},
 };
 
+// 在源码字符区间上直接识别关键字：先按长度、再按首字符分派，最后比较剩余字符
+// 关键字集合与 keywordMap 相同；不是关键字时返回 IDENTIFIER
+inline TokenType keywordType(const char *s, size_t n)
+{
+    auto is = [s, n](const char *kw, TokenType t)
+    { return memcmp(s, kw, n) == 0 ? t : TokenType::IDENTIFIER; };
+    switch (n)
+    {
+    case 2:
+        switch (s[0])
+        {
+        case 'i': return is("if", TokenType::IF);
+        case 'd': return is("do", TokenType::DO);
+        }
+        break;
+    case 3:
+        switch (s[0])
+        {
+        case 'i': return is("int", TokenType::INT);
+        case 'f': return is("for", TokenType::FOR);
+        }
+        break;
+    case 4:
+        switch (s[0])
+        {
+        case 'l': return is("long", TokenType::LONG);
+        case 'v': return is("void", TokenType::VOID);
+        case 'c':
+            if (s[1] == 'h')
+                return is("char", TokenType::CHAR);
+            return is("case", TokenType::CASE);
+        case 'e':
+            if (s[1] == 'l')
+                return is("else", TokenType::ELSE);
+            return is("enum", TokenType::ENUM);
+        }
+        break;
+    case 5:
+        switch (s[0])
+        {
+        case 's': return is("short", TokenType::SHORT);
+        case 'f': return is("float", TokenType::FLOAT);
+        case 'w': return is("while", TokenType::WHILE);
+        case 'b': return is("break", TokenType::BREAK);
+        case 'c': return is("const", TokenType::CONST);
+        case 'u':
+            if (s[2] == 'i')
+                return is("union", TokenType::UNION);
+            return is("undef", TokenType::UNDEF);
+        }
+        break;
+    case 6:
+        switch (s[0])
+        {
+        case 'd':
+            if (s[1] == 'o')
+                return is("double", TokenType::DOUBLE);
+            return is("define", TokenType::DEFINE);
+        case 'r': return is("return", TokenType::RETURN);
+        case 'e': return is("extern", TokenType::EXTERN);
+        case 's':
+            switch (s[1])
+            {
+            case 'w': return is("switch", TokenType::SWITCH);
+            case 'i':
+                if (s[2] == 'z')
+                    return is("sizeof", TokenType::SIZEOF);
+                return is("signed", TokenType::SIGNED);
+            case 't':
+                if (s[2] == 'a')
+                    return is("static", TokenType::STATIC);
+                return is("struct", TokenType::STRUCT);
+            }
+            break;
+        }
+        break;
+    case 7:
+        switch (s[0])
+        {
+        case 'd': return is("default", TokenType::DEFAULT);
+        case 't': return is("typedef", TokenType::TYPEDEF);
+        case 'i': return is("include", TokenType::INCLUDE);
+        }
+        break;
+    case 8:
+        switch (s[0])
+        {
+        case 'c': return is("continue", TokenType::CONTINUE);
+        case 'r': return is("register", TokenType::REGISTER);
+        case 'u': return is("unsigned", TokenType::UNSIGNED);
+        }
+        break;
+    }
+    return TokenType::IDENTIFIER;
+}
+
 static const unordered_map<TokenType, string> TokenMap{
     {TokenType::ERROR, "ERROR"},
     {TokenType::IDENTIFIER, "IDENTIFIER"},
@@ -159,8 +272,205 @@ static const unordered_map<TokenType, string> TokenMap{
     {TokenType::END_OF_FILE, "END_OF_FILE"},
 };
 
-const vector<TokenType> constants = {
-    TokenType::INT_CONST, TokenType::FLOAT_CONST, TokenType::CHAR_CONST, TokenType::STRING, TokenType::IDENTIFIER, TokenType::LONG_CONST, TokenType::DOUBLE_CONST, TokenType::LONG_LONG_CONST, TokenType::UNSIGNED_LONG_CONST, TokenType::UNSIGNED_LONG_LONG_CONST};
+static const size_t TOKEN_TYPE_COUNT = static_cast<size_t>(TokenType::NONE) + 1;
+
+// 表达式解析用的分类表，以 TokenType 为下标，程序启动时构造一次
+struct ExprTables
+{
+    int precedence[TOKEN_TYPE_COUNT]; // 二元运算符优先级，0 表示不是二元运算符
+    bool operand[TOKEN_TYPE_COUNT];   // 能否作为操作数（常量、字符串、标识符）
+    bool argumentEnd[TOKEN_TYPE_COUNT]; // 函数实参/条件表达式允许的结束符
+
+    ExprTables()
+    {
+        for (size_t i = 0; i < TOKEN_TYPE_COUNT; ++i)
+        {
+            precedence[i] = 0;
+            operand[i] = false;
+            argumentEnd[i] = false;
+        }
+        set(TokenType::OR, 1);
+        set(TokenType::AND, 2);
+        set(TokenType::BITWISE_OR, 3);
+        set(TokenType::BITWISE_XOR, 4);
+        set(TokenType::BITWISE_AND, 5);
+        set(TokenType::EQUAL, 6);
+        set(TokenType::NOT_EQUAL, 6);
+        set(TokenType::LESS_THAN, 7);
+        set(TokenType::LESS_EQUAL, 7);
+        set(TokenType::GREATER_THAN, 7);
+        set(TokenType::GREATER_EQUAL, 7);
+        set(TokenType::LEFT_SHIFT, 8);
+        set(TokenType::RIGHT_SHIFT, 8);
+        set(TokenType::ADD, 9);
+        set(TokenType::SUB, 9);
+        set(TokenType::MUL, 10);
+        set(TokenType::DIV, 10);
+        set(TokenType::MOD, 10);
+
+        const TokenType constants[] = {
+            TokenType::INT_CONST, TokenType::FLOAT_CONST, TokenType::CHAR_CONST, TokenType::STRING, TokenType::IDENTIFIER, TokenType::LONG_CONST, TokenType::DOUBLE_CONST, TokenType::LONG_LONG_CONST, TokenType::UNSIGNED_LONG_CONST, TokenType::UNSIGNED_LONG_LONG_CONST};
+        for (auto t : constants)
+            operand[static_cast<size_t>(t)] = true;
+
+        const TokenType argumentEnds[] = {
+            TokenType::SEMI, TokenType::COMMA, TokenType::RBRACKET, TokenType::RBRACE, TokenType::RPAREN};
+        for (auto t : argumentEnds)
+            argumentEnd[static_cast<size_t>(t)] = true;
+    }
+    void set(TokenType t, int prec) { precedence[static_cast<size_t>(t)] = prec; }
+};
+
+static const ExprTables exprTables;
+
+// 关键字与运算符的驻留字符串，以 TokenType 为下标；拼写不固定的记号为空串
+// 构造后只读，所有解析器（包括并行解析的各线程）共享，节点中的类型名与运算符不再各自保存副本
+struct FixedSymbols
+{
+    StringPool pool;
+    Symbol symbols[TOKEN_TYPE_COUNT];
+
+    FixedSymbols()
+    {
+        for (const auto &keyword : keywordMap)
+            symbols[static_cast<size_t>(keyword.second)] = pool.symbol(keyword.first);
+        static const pair<TokenType, const char *> operators[] = {
+            {TokenType::OR, "||"}, {TokenType::AND, "&&"}, {TokenType::BITWISE_OR, "|"}, {TokenType::BITWISE_XOR, "^"}, {TokenType::BITWISE_AND, "&"},
+            {TokenType::EQUAL, "=="}, {TokenType::NOT_EQUAL, "!="}, {TokenType::LESS_THAN, "<"}, {TokenType::LESS_EQUAL, "<="}, {TokenType::GREATER_THAN, ">"}, {TokenType::GREATER_EQUAL, ">="},
+            {TokenType::LEFT_SHIFT, "<<"}, {TokenType::RIGHT_SHIFT, ">>"}, {TokenType::ADD, "+"}, {TokenType::SUB, "-"}, {TokenType::MUL, "*"}, {TokenType::DIV, "/"}, {TokenType::MOD, "%"},
+            {TokenType::ASSIGN, "="}, {TokenType::ADD_ASSIGN, "+="}, {TokenType::SUB_ASSIGN, "-="}, {TokenType::MUL_ASSIGN, "*="}, {TokenType::DIV_ASSIGN, "/="}, {TokenType::MOD_ASSIGN, "%="},
+            {TokenType::LEFT_SHIFT_ASSIGN, "<<="}, {TokenType::RIGHT_SHIFT_ASSIGN, ">>="}, {TokenType::AND_ASSIGN, "&="}, {TokenType::OR_ASSIGN, "|="}, {TokenType::BITWISE_XOR_ASSIGN, "^="}};
+        for (const auto &op : operators)
+            symbols[static_cast<size_t>(op.first)] = pool.symbol(op.second, strlen(op.second));
+    }
+    Symbol of(TokenType t) const { return symbols[static_cast<size_t>(t)]; }
+};
+
+static const FixedSymbols fixedSymbols;
+
+// 一个声明中出现的类型说明符，在解析器消耗记号时逐个加入
+// mask 的低 8 位各对应一种说明符，第 8、9 位是 long 的个数（3 表示超过两个）；repeated 记录出现过两次的说明符
+struct TypeSpecifiers
+{
+    enum : uint16_t
+    {
+        VOID_BIT = 1 << 0,
+        CHAR_BIT_ = 1 << 1,
+        SHORT_BIT = 1 << 2,
+        INT_BIT = 1 << 3,
+        FLOAT_BIT = 1 << 4,
+        DOUBLE_BIT = 1 << 5,
+        SIGNED_BIT = 1 << 6,
+        UNSIGNED_BIT = 1 << 7,
+        LONG_UNIT = 1 << 8,
+        LONG_MASK = 3 << 8,
+        MASK_COUNT = 1 << 10
+    };
+    uint16_t mask = 0;
+    uint16_t repeated = 0;
+
+    void add(TokenType t);
+    int longCount() const { return mask >> 8; }
+};
+
+// 类型说明符的查表数据：记号对应的位，以及每个 mask 违反的第一条组合规则（0 为合法）
+struct TypeSpecifierTables
+{
+    uint16_t bit[TOKEN_TYPE_COUNT];
+    bool specifier[TOKEN_TYPE_COUNT]; // 可以出现在类型说明符序列中的记号（含 const）
+    uint8_t error[TypeSpecifiers::MASK_COUNT];
+
+    TypeSpecifierTables()
+    {
+        for (size_t i = 0; i < TOKEN_TYPE_COUNT; ++i)
+        {
+            bit[i] = 0;
+            specifier[i] = false;
+        }
+        const pair<TokenType, uint16_t> bits[] = {
+            {TokenType::VOID, TypeSpecifiers::VOID_BIT}, {TokenType::CHAR, TypeSpecifiers::CHAR_BIT_}, {TokenType::SHORT, TypeSpecifiers::SHORT_BIT},
+            {TokenType::INT, TypeSpecifiers::INT_BIT}, {TokenType::FLOAT, TypeSpecifiers::FLOAT_BIT}, {TokenType::DOUBLE, TypeSpecifiers::DOUBLE_BIT},
+            {TokenType::SIGNED, TypeSpecifiers::SIGNED_BIT}, {TokenType::UNSIGNED, TypeSpecifiers::UNSIGNED_BIT}, {TokenType::LONG, TypeSpecifiers::LONG_UNIT}};
+        for (const auto &b : bits)
+        {
+            bit[static_cast<size_t>(b.first)] = b.second;
+            specifier[static_cast<size_t>(b.first)] = true;
+        }
+        specifier[static_cast<size_t>(TokenType::CONST)] = true;
+        for (uint16_t mask = 0; mask < TypeSpecifiers::MASK_COUNT; ++mask)
+            error[mask] = rule(mask);
+    }
+
+    // 组合规则，返回值是 message() 的下标；只在构造时对每个 mask 求值一次
+    static uint8_t rule(uint16_t mask)
+    {
+        bool v = mask & TypeSpecifiers::VOID_BIT, c = mask & TypeSpecifiers::CHAR_BIT_, s = mask & TypeSpecifiers::SHORT_BIT;
+        bool i = mask & TypeSpecifiers::INT_BIT, f = mask & TypeSpecifiers::FLOAT_BIT, d = mask & TypeSpecifiers::DOUBLE_BIT;
+        bool sg = mask & TypeSpecifiers::SIGNED_BIT, u = mask & TypeSpecifiers::UNSIGNED_BIT;
+        int l = mask >> 8;
+        if (l > 2)
+            return 1;
+        if (u && sg)
+            return 2;
+        if (v && (i || c || f || d || s || l || sg || u))
+            return 3;
+        if (c && (i || f || d || s || l))
+            return 4;
+        if (f && (i || c || s || l || sg || u))
+            return 5;
+        if (d && s)
+            return 6;
+        if (d && (u || sg))
+            return 7;
+        if (d && l > 1)
+            return 8;
+        if (i && (f || d))
+            return 9;
+        return 0;
+    }
+    static const char *message(uint8_t error)
+    {
+        static const char *const messages[] = {
+            "",
+            "too many 'long'",
+            "'signed' and 'unsigned' cannot be used together",
+            "'void' cannot be combined with other types",
+            "'char' cannot be combined with 'int', 'float', 'double', 'short', or 'long'",
+            "'float' cannot be combined with 'int', 'char', 'short', 'long', 'signed', or 'unsigned'",
+            "'short double' is not allowed",
+            "'unsigned double' or 'signed double' is not allowed",
+            "too many 'long' for 'double'",
+            "'int' cannot be combined with 'float' or 'double'"};
+        return messages[error];
+    }
+};
+
+static const TypeSpecifierTables typeSpecifierTables;
+
+inline void TypeSpecifiers::add(TokenType t)
+{
+    uint16_t bit = typeSpecifierTables.bit[static_cast<size_t>(t)];
+    if (bit == LONG_UNIT)
+    {
+        if ((mask & LONG_MASK) != LONG_MASK)
+            mask += LONG_UNIT;
+    }
+    else
+    {
+        repeated |= mask & bit;
+        mask |= bit;
+    }
+}
+
+inline int binaryPrecedence(TokenType t)
+{
+    return exprTables.precedence[static_cast<size_t>(t)];
+}
+
+inline bool isOperandToken(TokenType t)
+{
+    return exprTables.operand[static_cast<size_t>(t)];
+}
 
 inline std::string tokenTypeToString(TokenType type)
 {
@@ -172,34 +482,74 @@ inline std::string tokenTypeToString(TokenType type)
     return "UNKNOWN";
 }
 
-void printToken(Token token)
+inline void printToken(const Token &token, ostream &out = cout)
 {
-    cout << "Token(Type: " << tokenTypeToString(token.type) << ", Lexeme: \"" << token.lexeme << "\", Line: " << token.line << ", Column: " << token.column << ")\n";
+    out << "Token(Type: " << tokenTypeToString(token.type) << ", Lexeme: \"" << token.lexeme << "\", Line: " << token.line << ", Column: " << token.column << ")\n";
 }
 
+// 词法分析计数，只做自增，供 --stats 使用
+struct LexerCounters
+{
+    size_t scanned = 0;  // 实际扫描出的 token（含注释）
+    size_t returned = 0; // gettoken 交给调用者的 token
+    size_t peeks = 0;    // peektoken 调用次数
+    size_t replayed = 0; // 由预读队列提供、无需重新扫描的 token
+    size_t seeks = 0;    // 需要向前扫描的 peektoken 调用：最初的实现在此 seekg 回退输入，现在由预读队列代替，读取位置从不回退
+    chrono::steady_clock::duration scanTime = chrono::steady_clock::duration::zero(); // 扫描耗时，仅在 timeScans() 后统计
+
+    LexerCounters &operator+=(const LexerCounters &other)
+    {
+        scanned += other.scanned;
+        returned += other.returned;
+        peeks += other.peeks;
+        replayed += other.replayed;
+        seeks += other.seeks;
+        scanTime += other.scanTime;
+        return *this;
+    }
+};
+
 class Lexer
 {
+public:
+    static const size_t LOOKAHEAD = 4; // 最多可预读的 token 数
+
 private:
-    istream &input;
+    SourceBuffer streamBuffer; // 仅在从 istream 构造时使用
+    const char *cur = nullptr;   // 下一个待读取的字符
+    const char *end = nullptr;
+    const char *chPos = nullptr; // ch 在缓冲区中的位置，到达末尾时等于 end
     int line = 1;
     int column = 0;
     char ch = ' ';
+    // 预读队列（环形缓冲区），保存已扫描但尚未被 gettoken 取走的 token
+    Token ahead[LOOKAHEAD];
+    size_t aheadHead = 0;
+    size_t aheadCount = 0;
+    LexerCounters counts;
+    bool timed = false;
 
 public:
-    Lexer(istream &in) : input(in)
+    // 直接在连续的源码缓冲区上扫描，调用者保证 src 在 Lexer 生命周期内有效
+    Lexer(const SourceBuffer &src) : cur(src.begin()), end(src.end())
     {
-        if (!input.eof())
-        {
-            next();
-        }
-        else
-        {
-            ch = EOF;
-        }
+        next();
+    }
+    // 从整体源码中间的 src 开始扫描（增量解析用），startLine/startColumn 为 src 起点之前的行号与列数
+    Lexer(const SourceBuffer &src, int startLine, int startColumn)
+        : cur(src.begin()), end(src.end()), line(startLine), column(startColumn)
+    {
+        next();
+    }
+    // 后备路径：无法映射的流（如标准输入）先整体读入
+    Lexer(istream &in) : streamBuffer(in), cur(streamBuffer.begin()), end(streamBuffer.end())
+    {
+        next();
     }
     void next()
     {
-        ch = input.get();
+        chPos = cur;
+        ch = cur != end ? *cur++ : EOF;
         if (ch == '\n')
         {
             line++;
@@ -219,110 +569,142 @@ public:
 
     Token gettoken()
     {
+        counts.returned++;
+        if (aheadCount > 0)
+        {
+            counts.replayed++;
+            Token token = ahead[aheadHead];
+            aheadHead = (aheadHead + 1) % LOOKAHEAD;
+            aheadCount--;
+            return token;
+        }
+        return timedScan();
+    }
+
+    // 查看第 k 个（从 1 开始）非注释 token 而不消耗它；每个 token 只扫描一次
+    // 注释在预读时直接丢弃，Parser::advance 本来也会跳过它们
+    const Token &peektoken(size_t k = 1)
+    {
+        assert(k >= 1 && k <= LOOKAHEAD);
+        counts.peeks++;
+        if (aheadCount < k)
+            counts.seeks++;
+        while (aheadCount < k)
+        {
+            Token token = timedScan();
+            if (token.type == TokenType::SIGNAL_COMMENT || token.type == TokenType::BLOCK_COMMENT)
+                continue;
+            ahead[(aheadHead + aheadCount) % LOOKAHEAD] = token;
+            aheadCount++;
+        }
+        return ahead[(aheadHead + k - 1) % LOOKAHEAD];
+    }
+
+    const LexerCounters &counters() const { return counts; }
+    // 统计扫描耗时（--stats 用）；每个 token 读两次单调时钟，默认关闭
+    void timeScans() { timed = true; }
+    // 已读取的最远位置：此前产生的 token（含预读）只依赖该位置之前的字符
+    const char *scanLimit() const { return cur; }
+    static Diagnostic unknownCharError(const Token &t)
+    {
+        return {t.line, t.column, "Unknown token: " + t.lexeme.str() + " at line " + std::to_string(t.line) + ", column " + std::to_string(t.column)};
+    }
+
+private:
+    Token timedScan()
+    {
+        if (!timed)
+            return scan();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+        Token token = scan();
+        counts.scanTime += chrono::steady_clock::now() - start;
+        return token;
+    }
+
+    Token scan()
+    {
+        counts.scanned++;
         skipSpace();
         if (ch == EOF)
-            return Token(TokenType::END_OF_FILE, "", line, column);
-        string lexeme;
+            return Token(TokenType::END_OF_FILE, text(chPos), line, column);
+        const char *start = chPos; // token 在缓冲区中的起点
         int tokenLine = line, tokenColumn = column;
         if (isalpha(ch) || ch == '_')
         {
             while (isalnum(ch) || ch == '_')
             {
-                lexeme += ch;
                 next();
             }
-            auto it = keywordMap.find(lexeme);
-            if (it != keywordMap.end())
-            {
-                return Token(it->second, lexeme, tokenLine, tokenColumn);
-            }
-            else
-            {
-                return Token(TokenType::IDENTIFIER, lexeme, tokenLine, tokenColumn);
-            }
+            return Token(keywordType(start, chPos - start), text(start), tokenLine, tokenColumn);
         }
         else if (isdigit(ch))
         {
             if (ch == '0')
             {
-                lexeme += ch;
                 next();
                 if (ch == 'x' || ch == 'X')
                 { // 十六进制
-                    lexeme += ch;
                     next();
                     while (isxdigit(ch))
                     {
-                        lexeme += ch;
                         next();
                     }
                     if (ch == 'u' || ch == 'U')
                     {
-                        lexeme += ch;
                         next();
                         if (ch == 'l' || ch == 'L')
                         {
-                            lexeme += ch;
                             next();
                             if (ch == 'l' || ch == 'L')
                             {
-                                lexeme += ch;
                                 next();
-                                return Token(TokenType::UNSIGNED_LONG_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                                return Token(TokenType::UNSIGNED_LONG_LONG_CONST, text(start), tokenLine, tokenColumn);
                             }
-                            return Token(TokenType::UNSIGNED_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                            return Token(TokenType::UNSIGNED_LONG_CONST, text(start), tokenLine, tokenColumn);
                         }
-                        return Token(TokenType::USIGNED_INT_CONST, lexeme, tokenLine, tokenColumn);
+                        return Token(TokenType::USIGNED_INT_CONST, text(start), tokenLine, tokenColumn);
                     }
                     if (ch == 'l' || ch == 'L')
                     {
-                        lexeme += ch;
                         next();
                         if (ch == 'l' || ch == 'L')
                         {
-                            lexeme += ch;
                             next();
-                            return Token(TokenType::LONG_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                            return Token(TokenType::LONG_LONG_CONST, text(start), tokenLine, tokenColumn);
                         }
-                        return Token(TokenType::LONG_CONST, lexeme, tokenLine, tokenColumn);
+                        return Token(TokenType::LONG_CONST, text(start), tokenLine, tokenColumn);
                     }
                 }
                 else if (isdigit(ch))
                 { // 八进制
                     while (ch >= '0' && ch <= '7')
                     {
-                        lexeme += ch;
                         next();
                     }
                     if (ch == 'u' || ch == 'U')
                     {
-                        lexeme += ch;
                         next();
                         if (ch == 'l' || ch == 'L')
                         {
-                            lexeme += ch;
                             next();
                             if (ch == 'l' || ch == 'L')
                             {
-                                lexeme += ch;
                                 next();
-                                return Token(TokenType::UNSIGNED_LONG_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                                return Token(TokenType::UNSIGNED_LONG_LONG_CONST, text(start), tokenLine, tokenColumn);
                             }
-                            return Token(TokenType::UNSIGNED_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                            return Token(TokenType::UNSIGNED_LONG_CONST, text(start), tokenLine, tokenColumn);
                         }
-                        return Token(TokenType::USIGNED_INT_CONST, lexeme, tokenLine, tokenColumn);
+                        return Token(TokenType::USIGNED_INT_CONST, text(start), tokenLine, tokenColumn);
                     }
                     if (ch == 'l' || ch == 'L')
                     {
-                        lexeme += ch;
                         next();
                         if (ch == 'l' || ch == 'L')
                         {
-                            lexeme += ch;
                             next();
-                            return Token(TokenType::LONG_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                            return Token(TokenType::LONG_LONG_CONST, text(start), tokenLine, tokenColumn);
                         }
-                        return Token(TokenType::LONG_CONST, lexeme, tokenLine, tokenColumn);
+                        return Token(TokenType::LONG_CONST, text(start), tokenLine, tokenColumn);
                     }
                 }
                 // 否则继续处理十进制或浮点
@@ -332,255 +714,230 @@ public:
             {
                 if (ch == '.')
                     dot = true;
-                lexeme += ch;
                 next();
             }
             if (ch == 'f' || ch == 'F')
             {
                 if (dot)
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::FLOAT_CONST, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::FLOAT_CONST, text(start), tokenLine, tokenColumn);
                 }
                 else
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                 }
             }
             if (ch == 'l' || ch == 'L')
             {
-                lexeme += ch;
                 next();
                 if (dot)
                 {
-                    return Token(TokenType::DOUBLE_CONST, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::DOUBLE_CONST, text(start), tokenLine, tokenColumn);
                 }
                 if (ch == 'l' || ch == 'L')
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::LONG_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::LONG_LONG_CONST, text(start), tokenLine, tokenColumn);
                 }
             }
             if (ch == 'u' || ch == 'U')
             {
-                lexeme += ch;
                 next();
                 if (dot)
                 {
-                    return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                 }
                 if (ch == 'l' || ch == 'L')
                 {
-                    lexeme += ch;
                     next();
                     if (ch == 'l' || ch == 'L')
                     {
-                        lexeme += ch;
                         next();
-                        return Token(TokenType::UNSIGNED_LONG_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                        return Token(TokenType::UNSIGNED_LONG_LONG_CONST, text(start), tokenLine, tokenColumn);
                     }
-                    return Token(TokenType::UNSIGNED_LONG_CONST, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::UNSIGNED_LONG_CONST, text(start), tokenLine, tokenColumn);
                 }
-                return Token(TokenType::USIGNED_INT_CONST, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::USIGNED_INT_CONST, text(start), tokenLine, tokenColumn);
             }
             // 检查指数
             if (ch == 'e' || ch == 'E')
             {
-                lexeme += ch;
                 next();
                 if (ch == '+' || ch == '-')
                 {
-                    lexeme += ch;
                     next();
                 }
                 while (isdigit(ch))
                 {
-                    lexeme += ch;
                     next();
                 }
                 dot = true; // 科学计数法也是浮点
             }
             if (dot)
             {
-                return Token(TokenType::DOUBLE_CONST, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::DOUBLE_CONST, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::INT_CONST, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::INT_CONST, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '.')
         {
-            lexeme += ch;
             next();
             if (isdigit(ch))
             {
                 bool dot = true;
                 while (isdigit(ch))
                 {
-                    lexeme += ch;
                     next();
                 }
-                return Token(TokenType::FLOAT_CONST, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::FLOAT_CONST, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::DOT, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::DOT, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == ',')
         {
             next();
-            return Token(TokenType::COMMA, ",", tokenLine, tokenColumn);
+            return Token(TokenType::COMMA, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '"')
         {
             next();
+            start = chPos; // 字符串的 lexeme 不含引号
 
             while (ch != '"')
             {
                 if (ch == EOF)
                 {
-                    lexeme += ch;
-                    return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                 }
-                lexeme += ch;
                 next();
             }
+            SourceRef content = text(start);
             if (ch == '"')
                 next();
-            return Token(TokenType::STRING, lexeme, tokenLine, tokenColumn);
+            return Token(TokenType::STRING, content, tokenLine, tokenColumn);
         }
         else if (ch == ';')
         {
             next();
-            return Token(TokenType::SEMI, ";", tokenLine, tokenColumn);
+            return Token(TokenType::SEMI, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '#')
         {
             next();
-            return Token(TokenType::HASHTAG, "#", tokenLine, tokenColumn);
+            return Token(TokenType::HASHTAG, text(start), tokenLine, tokenColumn);
         }
         else if (ch == ':')
         {
             next();
-            return Token(TokenType::COLON, ":", tokenLine, tokenColumn);
+            return Token(TokenType::COLON, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '(')
         {
             next();
-            return Token(TokenType::LPAREN, "(", tokenLine, tokenColumn);
+            return Token(TokenType::LPAREN, text(start), tokenLine, tokenColumn);
         }
         else if (ch == ')')
         {
             next();
-            return Token(TokenType::RPAREN, ")", tokenLine, tokenColumn);
+            return Token(TokenType::RPAREN, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '{')
         {
             next();
-            return Token(TokenType::LBRACE, "{", tokenLine, tokenColumn);
+            return Token(TokenType::LBRACE, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '}')
         {
             next();
-            return Token(TokenType::RBRACE, "}", tokenLine, tokenColumn);
+            return Token(TokenType::RBRACE, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '[')
         {
             next();
-            return Token(TokenType::LBRACKET, "[", tokenLine, tokenColumn);
+            return Token(TokenType::LBRACKET, text(start), tokenLine, tokenColumn);
         }
         else if (ch == ']')
         {
             next();
-            return Token(TokenType::RBRACKET, "]", tokenLine, tokenColumn);
+            return Token(TokenType::RBRACKET, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '+')
         {
-            lexeme += ch;
             next();
             if (ch == '+')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::INCREMENT, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::INCREMENT, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::ADD_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::ADD_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::ADD, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::ADD, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '-')
         {
-            lexeme += ch;
             next();
             if (ch == '-')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::DECREMENT, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::DECREMENT, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::SUB_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::SUB_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '>')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::ARROW, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::ARROW, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::SUB, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::SUB, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '*')
         {
-            lexeme += ch;
             next();
             if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::MUL_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::MUL_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::MUL, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::MUL, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '/')
         {
-            lexeme += ch;
             next();
             if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::DIV_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::DIV_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '/')
             {
                 while (ch != '\n' && ch != EOF)
                 {
-                    lexeme += ch;
                     next();
                 }
-                return Token(TokenType::SIGNAL_COMMENT, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::SIGNAL_COMMENT, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '*')
             {
@@ -588,7 +945,7 @@ public:
                 while (true)
                 {
                     if (ch == EOF)
-                        return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                        return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                     if (ch == '*')
                     {
                         next();
@@ -600,399 +957,440 @@ public:
                     }
                     else
                     {
-                        lexeme += ch;
                         next();
                     }
                 }
-                return Token(TokenType::BLOCK_COMMENT, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::BLOCK_COMMENT, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::DIV, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::DIV, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '%')
         {
-            lexeme += ch;
             next();
             if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::MOD_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::MOD_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::MOD, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::MOD, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '=')
         {
-            lexeme += ch;
             next();
             if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::EQUAL, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::EQUAL, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::ASSIGN, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '<')
         {
-            lexeme += ch;
             next();
             if (ch == '<')
             {
-                lexeme += ch;
                 next();
                 if (ch == '=')
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::LEFT_SHIFT_ASSIGN, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::LEFT_SHIFT_ASSIGN, text(start), tokenLine, tokenColumn);
                 }
                 else
                 {
-                    return Token(TokenType::LEFT_SHIFT, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::LEFT_SHIFT, text(start), tokenLine, tokenColumn);
                 }
             }
             else if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::LESS_EQUAL, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::LESS_EQUAL, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::LESS_THAN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::LESS_THAN, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '>')
         {
-            lexeme += ch;
             next();
             if (ch == '>')
             {
-                lexeme += ch;
                 next();
                 if (ch == '=')
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::RIGHT_SHIFT_ASSIGN, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::RIGHT_SHIFT_ASSIGN, text(start), tokenLine, tokenColumn);
                 }
                 else
                 {
-                    return Token(TokenType::RIGHT_SHIFT, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::RIGHT_SHIFT, text(start), tokenLine, tokenColumn);
                 }
             }
             else if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::GREATER_EQUAL, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::GREATER_EQUAL, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::GREATER_THAN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::GREATER_THAN, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '!')
         {
-            lexeme += ch;
             next();
             if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::NOT_EQUAL, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::NOT_EQUAL, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::NOT, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::NOT, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '&')
         {
-            lexeme += ch;
             next();
             if (ch == '&')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::AND, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::AND, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::AND_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::AND_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::BITWISE_AND, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::BITWISE_AND, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '|')
         {
-            lexeme += ch;
             next();
             if (ch == '|')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::OR, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::OR, text(start), tokenLine, tokenColumn);
             }
             else if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::OR_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::OR_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::BITWISE_OR, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::BITWISE_OR, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '^')
         {
-            lexeme += ch;
             next();
             if (ch == '=')
             {
-                lexeme += ch;
                 next();
-                return Token(TokenType::BITWISE_XOR_ASSIGN, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::BITWISE_XOR_ASSIGN, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                return Token(TokenType::BITWISE_XOR, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::BITWISE_XOR, text(start), tokenLine, tokenColumn);
             }
         }
         else if (ch == '~')
         {
-            lexeme += ch;
             next();
-            return Token(TokenType::BITWISE_NOT, lexeme, tokenLine, tokenColumn);
+            return Token(TokenType::BITWISE_NOT, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '\'')
         {
-            lexeme += ch;
             next();
             if (ch == '\\')
             {
-                lexeme += ch;
                 next();
                 if (ch == EOF)
                 {
-                    return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                 }
-                switch (ch)
-                {
-                case 'n':
-                    ch = '\n';
-                    break;
-                case 't':
-                    ch = '\t';
-                    break;
-                case '\\':
-                    ch = '\\';
-                    break;
-                case '\'':
-                    ch = '\'';
-                    break;
-                }
-                lexeme += ch;
+                // 转义序列按源码原样保留在 lexeme 中
                 next();
                 if (ch == '\'')
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::CHAR_CONST, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::CHAR_CONST, text(start), tokenLine, tokenColumn);
                 }
                 else
                 {
-                    return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                 }
             }
             else if (ch == EOF)
             {
-                return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
             }
             else
             {
-                lexeme += ch;
                 next();
                 if (ch == '\'')
                 {
-                    lexeme += ch;
                     next();
-                    return Token(TokenType::CHAR_CONST, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::CHAR_CONST, text(start), tokenLine, tokenColumn);
                 }
                 else
                 {
-                    return Token(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
+                    return Token(TokenType::ERROR, text(start), tokenLine, tokenColumn);
                 }
             }
         }
         else if (ch == '?')
         {
-            lexeme += ch;
             next();
-            return Token(TokenType::QUESTMARK, lexeme, tokenLine, tokenColumn);
+            return Token(TokenType::QUESTMARK, text(start), tokenLine, tokenColumn);
         }
         else if (ch == '\\')
         {
             // 处理行继续符
-            lexeme += ch;
             next();
-            return Token(TokenType::BACKSLASH, lexeme, tokenLine, tokenColumn);
+            return Token(TokenType::BACKSLASH, text(start), tokenLine, tokenColumn);
         }
 
-        lexeme += ch;
-        Token errorToken(TokenType::ERROR, lexeme, tokenLine, tokenColumn);
-        throw std::runtime_error("Unknown token: " + lexeme + " at line " + std::to_string(tokenLine) + ", column " + std::to_string(tokenColumn));
+        // 无法识别的字符：作为 ERROR 记号交给解析器报告
         next();
-        return errorToken;
+        Token unknown(TokenType::ERROR, text(start), tokenLine, tokenColumn);
+        unknown.unknownChar = true;
+        return unknown;
     }
 
-    Token peektoken()
+    // 从 start 到当前字符（不含）的源码片段
+    SourceRef text(const char *start) const
     {
-        auto currentPos = input.tellg();
-        int currentLine = line;
-        int currentColumn = column;
-        char currentCh = ch;
+        return SourceRef(start, chPos - start);
+    }
+};
 
-        try
-        {
-            Token nextToken = gettoken();
-            while (nextToken.type == TokenType::SIGNAL_COMMENT || nextToken.type == TokenType::BLOCK_COMMENT)
-            {
-                nextToken = gettoken();
-            }
+// 解析跟踪事件：标签为字符串字面量，token 只记录其在源码中的位置，不复制文本
+struct TraceEvent
+{
+    const char *label = "";
+    bool hasToken = false;
+    bool hasValue = false;
+    Token token;
+    size_t value = 0;
+};
 
-            input.clear(); // 清除EOF标志
-            input.seekg(currentPos);
-            line = currentLine;
-            column = currentColumn;
-            ch = currentCh;
+// 发布构建使用的跟踪策略：全部为空内联函数，调用点被编译器整体消除
+struct NullTrace
+{
+    void event(const char *) {}
+    void event(const char *, size_t) {}
+    void token(const char *, const Token &) {}
+    void suspend(bool) {}
+    void dump(ostream &) const {}
+};
 
-            return nextToken;
-        }
-        catch (...)
-        {
-            // Restore the lexer state in case of an exception
-            input.clear(); // 清除EOF标志
-            input.seekg(currentPos);
-            line = currentLine;
-            column = currentColumn;
-            ch = currentCh;
+// 调试构建使用的跟踪策略：事件写入固定容量的环形缓冲区，只保留最近的 CAPACITY 条
+// 出错时把缓冲区转储出来即可看到出错前的解析路径
+class RingTrace
+{
+public:
+    static const size_t CAPACITY = 4096;
+
+private:
+    vector<TraceEvent> ring;
+    size_t head = 0;  // 下一条事件的写入位置
+    size_t total = 0; // 累计记录的事件数
+    bool suspended = false;
+    TraceEvent discarded; // 暂停期间的事件写到这里
+
+    TraceEvent &push(const char *label)
+    {
+        if (suspended)
+            return discarded;
+        if (ring.size() < CAPACITY)
+            ring.push_back(TraceEvent());
+        TraceEvent &e = ring[head];
+        head = (head + 1) % CAPACITY;
+        total++;
+        e.label = label;
+        e.hasToken = false;
+        e.hasValue = false;
+        return e;
+    }
 
-            throw; // Re-throw the exception
+public:
+    void event(const char *label) { push(label); }
+    void event(const char *label, size_t value)
+    {
+        TraceEvent &e = push(label);
+        e.hasValue = true;
+        e.value = value;
+    }
+    void token(const char *label, const Token &t)
+    {
+        TraceEvent &e = push(label);
+        e.hasToken = true;
+        e.token = t;
+    }
+    // 暂停期间不记录事件：解析器出错后逐层返回时暂停，转储的最后一条即出错位置
+    void suspend(bool on) { suspended = on; }
+    size_t eventCount() const { return total; }
+
+    // 按时间顺序输出缓冲区中的事件
+    void dump(ostream &out) const
+    {
+        if (total > ring.size())
+            out << "... " << total - ring.size() << " earlier trace events dropped\n";
+        size_t start = ring.size() < CAPACITY ? 0 : head;
+        for (size_t i = 0; i < ring.size(); ++i)
+        {
+            const TraceEvent &e = ring[(start + i) % ring.size()];
+            out << e.label;
+            if (e.hasToken)
+            {
+                out << " ";
+                printToken(e.token, out);
+            }
+            else if (e.hasValue)
+                out << ": " << e.value << "\n";
+            else
+                out << "\n";
         }
     }
 };
 
-class Parser
+// 语法分析器；Trace 为跟踪策略，NullTrace 的所有调用都是空内联函数，在发布构建中被完全消除
+template <typename Trace>
+class BasicParser
 {
 private:
     Lexer lexer;
     Token currentToken;
-    vector<string> funcNames; // 用于存储函数名
-    bool debug = false;
-    void throwError(const string &message)
+    Trace trace;
+    ASTArena ownArena;
+    ASTArena *arena; // 本次解析所有节点的分配位置
+    const char *consumedEnd = nullptr;         // 最近消耗的记号在源码中的结束位置
+    int blockIndent = 0;                       // 正在解析的语句输出时的缩进层数
+    vector<CompoundStmt *> *blocks = nullptr;  // 非空时记录解析到的每个语句块（范围格式化用）
+    vector<Diagnostic> *diagnostics = nullptr; // 非空时开启错误恢复：语法错误记入其中，跳过出错部分继续解析
+    bool hasFailed = false;                    // 出错状态，见 fail()
+    Diagnostic failure;                        // 第一个错误
+    const char *lastUnknown = nullptr;         // 最近报告过的无法识别的字符，预读时报告过的不再重复报告
+    size_t escalatedAt = SIZE_MAX;             // 语句块中的错误交给顶层处理时，它在 diagnostics 中的位置
+    // 记号在源码中的范围；字符串的 lexeme 不含引号
+    static const char *tokenBegin(const Token &t)
+    {
+        return t.type == TokenType::STRING ? t.lexeme.data() - 1 : t.lexeme.data();
+    }
+    static const char *tokenEnd(const Token &t)
+    {
+        return t.type == TokenType::STRING ? t.lexeme.end() + 1 : t.lexeme.end();
+    }
+    // 记录语法错误并进入出错状态，返回 nullptr 供产生式直接 return；出错的记号是无法识别的字符时按词法错误报告
+    // 出错后 advance/eat 不再移动 currentToken，循环随之结束，递归的产生式（语句、语句块、表达式、初始化列表）入口处直接返回，
+    // 错误由此逐层传回调用者；只保留第一个错误，currentToken 停在出错的记号上
+    std::nullptr_t fail(const string &message)
     {
-        throw std::runtime_error(
-            "Syntax error at line " + std::to_string(currentToken.line) +
-            ", column " + std::to_string(currentToken.column) +
-            ": " + message);
+        if (!hasFailed && isNewUnknownChar(currentToken))
+        {
+            hasFailed = true;
+            trace.suspend(true);
+            lastUnknown = currentToken.lexeme.data();
+            failure = Lexer::unknownCharError(currentToken);
+        }
+        else if (!hasFailed)
+        {
+            hasFailed = true;
+            trace.suspend(true);
+            failure = {currentToken.line, currentToken.column,
+                       "Syntax error at line " + std::to_string(currentToken.line) +
+                           ", column " + std::to_string(currentToken.column) +
+                           ": " + message};
+        }
+        return nullptr;
+    }
+    bool isNewUnknownChar(const Token &t) const
+    {
+        return t.unknownChar && t.lexeme.data() > lastUnknown;
+    }
+    // 预读到无法识别的字符：按词法错误进入出错状态，与语法错误一样可以恢复
+    void failOnLexerError(const Token &t)
+    {
+        if (hasFailed || !isNewUnknownChar(t))
+            return;
+        lastUnknown = t.lexeme.data();
+        hasFailed = true;
+        trace.suspend(true);
+        failure = Lexer::unknownCharError(t);
+    }
+    // 错误恢复：记下错误后回到正常状态继续解析
+    void clearFailure()
+    {
+        hasFailed = false;
+        trace.suspend(false);
+    }
+    // 预读下一个记号
+    const Token &peek()
+    {
+        const Token &t = lexer.peektoken();
+        failOnLexerError(t);
+        return t;
+    }
+    // 记号的驻留字符串：关键字与运算符取共享表，其余驻留到本次解析的 arena
+    Symbol symbol(const Token &t)
+    {
+        Symbol fixed = fixedSymbols.of(t.type);
+        return fixed.empty() ? arena->intern(t.lexeme) : fixed;
     }
     bool isStorageType(TokenType t)
     {
         return t == TokenType::STATIC || t == TokenType::EXTERN || t == TokenType::REGISTER;
     }
-    void checkTypeCombination(const std::vector<std::string> &typeName)
-    {
-        int longCount = 0, shortCount = 0, intCount = 0, voidCount = 0, doubleCount = 0, floatCount = 0, charCount = 0, signedCount = 0, unsignedCount = 0;
-
-        for (auto &t : typeName)
-        {
-            if (t == "unsigned")
-                unsignedCount++;
-            else if (t == "signed")
-                signedCount++;
-            else if (t == "int")
-                intCount++;
-            else if (t == "char")
-                charCount++;
-            else if (t == "float")
-                floatCount++;
-            else if (t == "double")
-                doubleCount++;
-            else if (t == "long")
-                longCount++;
-            else if (t == "short")
-                shortCount++;
-            else if (t == "void")
-                voidCount++;
-        }
-
-        // 1. 数量约束
-        if (shortCount > 1)
-            throwError("multiple 'short'");
-        if (longCount > 2)
-            throwError("too many 'long'");
-        if (intCount > 1)
-            throwError("multiple 'int'");
-        if (voidCount > 1)
-            throwError("multiple 'void'");
-        if (floatCount > 1)
-            throwError("multiple 'float'");
-        if (doubleCount > 1)
-            throwError("multiple 'double'");
-        if (charCount > 1)
-            throwError("multiple 'char'");
-        if (signedCount > 1)
-            throwError("multiple 'signed'");
-        if (unsignedCount > 1)
-            throwError("multiple 'unsigned'");
-
-        // 2. signed / unsigned 互斥
-        if (unsignedCount && signedCount)
-            throwError("'signed' and 'unsigned' cannot be used together");
-
-        // 3. void 不能和其他类型组合
-        if (voidCount && (intCount || charCount || floatCount || doubleCount || shortCount || longCount || signedCount || unsignedCount))
-            throwError("'void' cannot be combined with other types");
-
-        // 4. char 规则
-        if (charCount & (intCount || floatCount || doubleCount || shortCount || longCount))
-            throwError("'char' cannot be combined with 'int', 'float', 'double', 'short', or 'long'");
-        // 5. float / double 规则
-        if (floatCount && (intCount || charCount || shortCount || longCount || signedCount || unsignedCount))
-            throwError("'float' cannot be combined with 'int', 'char', 'short', 'long', 'signed', or 'unsigned'");
-        if (doubleCount)
-        {
-            if (shortCount)
-                throwError("'short double' is not allowed");
-            if (unsignedCount || signedCount)
-                throwError("'unsigned double' or 'signed double' is not allowed");
-            if (longCount > 1)
-                throwError("too many 'long' for 'double'");
-            // allow "long double"
-        }
-        // 6. int 规则
-        if (intCount && (floatCount || doubleCount))
-            throwError("'int' cannot be combined with 'float' or 'double'");
+    bool isTypeSpecifier(TokenType t)
+    {
+        return typeSpecifierTables.specifier[static_cast<size_t>(t)];
+    }
+    bool checkTypeCombination(const TypeSpecifiers &spec)
+    {
+        // 重复的说明符按固定顺序报告，long 过多与之同列
+        if (spec.repeated || spec.longCount() > 2)
+        {
+            static const pair<uint16_t, const char *> repeats[] = {
+                {TypeSpecifiers::SHORT_BIT, "multiple 'short'"}, {TypeSpecifiers::LONG_MASK, "too many 'long'"},
+                {TypeSpecifiers::INT_BIT, "multiple 'int'"}, {TypeSpecifiers::VOID_BIT, "multiple 'void'"},
+                {TypeSpecifiers::FLOAT_BIT, "multiple 'float'"}, {TypeSpecifiers::DOUBLE_BIT, "multiple 'double'"},
+                {TypeSpecifiers::CHAR_BIT_, "multiple 'char'"}, {TypeSpecifiers::SIGNED_BIT, "multiple 'signed'"},
+                {TypeSpecifiers::UNSIGNED_BIT, "multiple 'unsigned'"}};
+            for (const auto &r : repeats)
+            {
+                if (r.first == TypeSpecifiers::LONG_MASK ? spec.longCount() > 2 : (spec.repeated & r.first) != 0)
+                {
+                    fail(r.second);
+                    return false;
+                }
+            }
+        }
+        if (uint8_t error = typeSpecifierTables.error[spec.mask])
+        {
+            fail(TypeSpecifierTables::message(error));
+            return false;
+        }
+        return true;
     }
     VarInitList *arrInitList()
     {
-        if (debug)
-            cout << "arrInitList" << endl;
+        if (hasFailed)
+            return nullptr;
+        trace.event("arrInitList");
         if (currentToken.type == TokenType::SIGNAL_COMMENT || currentToken.type == TokenType::BLOCK_COMMENT)
         {
             advance();
@@ -1000,9 +1398,9 @@ private:
         else if (currentToken.type == TokenType::STRING)
         {
             // 字符数组初始化
-            auto strNode = new Literal(currentToken.lexeme, currentToken.type);
+            auto strNode = arena->make<Literal>(symbol(currentToken), currentToken.type);
             advance();
-            return new VarInitList({strNode});
+            return arena->make<VarInitList>(vector<ASTNode *>{strNode});
         }
 
         eat(TokenType::LBRACE);
@@ -1010,7 +1408,7 @@ private:
         // 允许空初始化列表 {}
         if (currentToken.type != TokenType::RBRACE)
         {
-            while (true)
+            while (!hasFailed)
             {
                 if (currentToken.type == TokenType::LBRACE)
                 {
@@ -1035,17 +1433,137 @@ private:
             }
         }
         eat(TokenType::RBRACE);
-        return new VarInitList(initList);
+        return arena->make<VarInitList>(initList);
+    }
+
+    // 错误恢复中跳过一个记号；跳过的部分中无法识别的字符记为诊断，不中断跳过
+    void skipToken()
+    {
+        if (isNewUnknownChar(currentToken))
+        {
+            lastUnknown = currentToken.lexeme.data();
+            diagnostics->push_back(Lexer::unknownCharError(currentToken));
+        }
+        advance();
+    }
+
+    // 语句块中出错后跳过记号：到本层的 ';' 为止（含），或到本层的 '}' 之前，留给语句块自己
+    void skipStatement()
+    {
+        int depth = 0;
+        while (!atEnd())
+        {
+            TokenType t = currentToken.type;
+            if (t == TokenType::RBRACE && depth == 0)
+                return;
+            skipToken();
+            if (t == TokenType::LBRACE)
+                ++depth;
+            else if (t == TokenType::RBRACE && --depth == 0)
+                return;
+            else if (t == TokenType::SEMI && depth == 0)
+                return;
+        }
+    }
+
+    bool startsExtdef(TokenType t)
+    {
+        return isStorageType(t) || isTypeSpecifier(t) || t == TokenType::TYPEDEF || t == TokenType::HASHTAG;
+    }
+
+    // 顶层定义出错后重新同步：跳到括号深度为 0 的 ';'、'}' 或错误记号之后，且其后是下一个顶层定义的开头
+    // 出错位置的深度由重新扫描 [begin, 出错记号) 得到，字符串与注释中的括号不计
+    void skipExtdef(const char *begin)
+    {
+        int depth = 0;
+        const char *stop = tokenBegin(currentToken);
+        if (stop > begin)
+        {
+            Lexer scan(SourceBuffer(begin, (size_t)(stop - begin)));
+            for (Token t = scan.gettoken(); t.type != TokenType::END_OF_FILE; t = scan.gettoken())
+            {
+                if (t.type == TokenType::LBRACE)
+                    ++depth;
+                else if (t.type == TokenType::RBRACE && depth > 0)
+                    --depth;
+            }
+        }
+        while (!atEnd())
+        {
+            TokenType t = currentToken.type;
+            skipToken();
+            if (t == TokenType::LBRACE)
+                ++depth;
+            else if (t == TokenType::RBRACE && depth > 0)
+                --depth;
+            if ((t == TokenType::SEMI || t == TokenType::RBRACE || t == TokenType::ERROR) && depth == 0 &&
+                (atEnd() || startsExtdef(currentToken.type)))
+                return;
+        }
+    }
+
+    // 从 begin 到最近消耗的记号为止的原文
+    ASTNode *verbatim(const char *begin)
+    {
+        auto node = arena->make<VerbatimNode>(string(begin, consumedEnd > begin ? consumedEnd : begin));
+        node->setSource(begin, consumedEnd > begin ? consumedEnd : begin);
+        return node;
+    }
+
+    // 语句块与 case 中的一条语句；开启错误恢复时，出错的语句记录诊断后按原文保留
+    template <typename Parse>
+    ASTNode *blockStatement(Parse parse)
+    {
+        const char *begin = tokenBegin(currentToken);
+        int indent = blockIndent;
+        ASTNode *stmt = parse();
+        // statement() 不认识的记号（如多余的 ']'）既不产生节点也不消耗记号，语句块会在原地反复解析，按语法错误处理
+        if (!stmt && !hasFailed && tokenBegin(currentToken) == begin)
+            fail("unexpected token in statement: " + tokenTypeToString(currentToken.type));
+        if (!diagnostics || !hasFailed)
+            return stmt;
+        if (atEnd())
+            return nullptr; // 已经到达文件末尾，交给顶层处理
+        Diagnostic error = failure;
+        size_t reported = diagnostics->size();
+        clearFailure();
+        blockIndent = indent;
+        skipStatement();
+        if (atEnd())
+        {
+            // 语句块没有结束，交给顶层按整个定义处理；跳过时记下的词法错误排在它之后
+            hasFailed = true;
+            trace.suspend(true);
+            failure = error;
+            escalatedAt = reported;
+            return nullptr;
+        }
+        diagnostics->insert(diagnostics->begin() + reported, error);
+        return verbatim(begin);
     }
 
 public:
-    Parser(istream &in, bool debug) : lexer(in), currentToken(lexer.gettoken()), debug(debug) {};
+    // 不指定 arena 时，节点归 Parser 自带的 arena 所有，随 Parser 一起释放
+    BasicParser(istream &in, ASTArena *nodeArena = nullptr)
+        : lexer(in), currentToken(lexer.gettoken()), arena(nodeArena ? nodeArena : &ownArena) {}
+    BasicParser(const SourceBuffer &src, ASTArena *nodeArena = nullptr)
+        : lexer(src), currentToken(lexer.gettoken()), arena(nodeArena ? nodeArena : &ownArena) {}
+    const Trace &traceEvents() const { return trace; }
+    // 从整体源码中间开始解析一串顶层定义（增量解析用）
+    BasicParser(const SourceBuffer &src, int line, int column, ASTArena *nodeArena)
+        : lexer(src, line, column), currentToken(lexer.gettoken()), arena(nodeArena ? nodeArena : &ownArena) {}
+    const LexerCounters &lexerCounters() const { return lexer.counters(); }
+    void timeLexer() { lexer.timeScans(); }
+    size_t nodeCount() const { return arena->nodeCount(); }
     void advance()
     {
+        if (hasFailed)
+            return;
+        consumedEnd = tokenEnd(currentToken);
         currentToken = lexer.gettoken();
         while (currentToken.type == TokenType::SIGNAL_COMMENT || currentToken.type == TokenType::BLOCK_COMMENT)
         {
-            advance();
+            currentToken = lexer.gettoken();
         }
     }
     void eat(TokenType expected)
@@ -1056,46 +1574,85 @@ public:
         }
         else
         {
-            throwError("expected token " + tokenTypeToString(expected) + ", got " + tokenTypeToString(currentToken.type));
+            fail("expected token " + tokenTypeToString(expected) + ", got " + tokenTypeToString(currentToken.type));
         }
     }
 
     ASTNode *program()
     {
-        if (currentToken.type == TokenType::ERROR)
+        if (currentToken.type == TokenType::ERROR && !diagnostics)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "program" << endl;
-        auto node = new ProgramNode();
-        while (currentToken.type != TokenType::END_OF_FILE)
+        trace.event("program");
+        vector<ASTNode *> items;
+        // 错误恢复时 recoveringItem 总是回到正常状态，第一个记号就是词法错误时也从它开始恢复
+        while (!atEnd() && (diagnostics || !hasFailed))
+            items.push_back(diagnostics ? recoveringItem() : topLevelItem());
+        trace.event("number of extdefs", items.size());
+        return hasFailed ? nullptr : arena->make<ProgramNode>(items);
+    }
+
+    bool atEnd() const { return currentToken.type == TokenType::END_OF_FILE; }
+    // 下一个顶层定义（含其前面的注释）在源码中的起点
+    const char *itemStart() const { return currentToken.lexeme.data(); }
+    const char *scanLimit() const { return lexer.scanLimit(); }
+    // 之后解析到的每个 CompoundStmt 都追加到 out 中
+    void recordBlocks(vector<CompoundStmt *> *out) { blocks = out; }
+    // 开启错误恢复：语法错误与词法错误追加到 out 后继续解析，出错的顶层定义或语句按原文输出
+    void recoverErrors(vector<Diagnostic> *out) { diagnostics = out; }
+    // program() 或 topLevelItem() 返回 nullptr 时为 true，error() 为错误信息
+    bool failed() const { return hasFailed; }
+    const Diagnostic &error() const { return failure; }
+
+    // 解析一个顶层定义，结束时 currentToken 为下一个顶层定义的第一个 token；出错时返回 nullptr
+    ASTNode *topLevelItem()
+    {
+        if (currentToken.type == TokenType::SIGNAL_COMMENT || currentToken.type == TokenType::BLOCK_COMMENT)
         {
-            auto ext = extdef();
-            if (debug)
-                cout << "extdef-parsed" << endl;
-            if (ext)
-                node->extdeflists.push_back(ext);
-            else
-            {
-                throwError("invalid external definition");
-            }
-            if (debug)
-                printToken(currentToken);
+            advance();
         }
-        if (debug)
-            cout << "number of extdefs: " << node->extdeflists.size() << endl;
-        return node;
+        const char *begin = tokenBegin(currentToken);
+        auto ext = extdef();
+        trace.event("extdef-parsed");
+        if (hasFailed)
+            return nullptr;
+        if (!ext)
+        {
+            return fail("invalid external definition");
+        }
+        ext->setSource(begin, consumedEnd);
+        trace.token("extdef-next", currentToken);
+        return ext;
+    }
+
+    // 错误恢复模式下的 topLevelItem：出错时跳到下一个顶层定义（见 skipExtdef），出错的定义按原文保留
+    ASTNode *recoveringItem()
+    {
+        if (currentToken.type == TokenType::SIGNAL_COMMENT || currentToken.type == TokenType::BLOCK_COMMENT)
+        {
+            advance();
+        }
+        const char *begin = tokenBegin(currentToken);
+        int indent = blockIndent;
+        ASTNode *item = topLevelItem();
+        if (!hasFailed)
+            return item;
+        diagnostics->insert(diagnostics->begin() + (escalatedAt != SIZE_MAX ? escalatedAt : diagnostics->size()), failure);
+        escalatedAt = SIZE_MAX;
+        clearFailure();
+        blockIndent = indent;
+        skipExtdef(begin);
+        return verbatim(begin);
     }
 
     ASTNode *extdef()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "extdef " << currentToken.lexeme << endl;
+        trace.token("extdef", currentToken);
         if (currentToken.type == TokenType::SIGNAL_COMMENT || currentToken.type == TokenType::BLOCK_COMMENT)
         {
             advance();
@@ -1104,16 +1661,17 @@ public:
         {
             return preProcessor();
         }
-        vector<string> typeName;
+        vector<Symbol> typeName;
+        TypeSpecifiers spec;
         bool HasStorageClass = false, HasTypeSpec = false;
         // 处理存储类型
-        while (isStorageType(currentToken.type))
+        while (isStorageType(currentToken.type) && !hasFailed)
         {
             if (HasStorageClass && isStorageType(currentToken.type))
-                throwError("multiple storage class specifiers");
+                return fail("multiple storage class specifiers");
 
             HasStorageClass = true;
-            typeName.push_back(currentToken.lexeme);
+            typeName.push_back(symbol(currentToken));
 
             advance();
         }
@@ -1121,40 +1679,41 @@ public:
         if (currentToken.type == TokenType::TYPEDEF)
         {
             if (HasStorageClass)
-                throwError("storage class specifier and 'typedef' cannot be used together");
-            typeName.push_back(currentToken.lexeme);
+                return fail("storage class specifier and 'typedef' cannot be used together");
+            typeName.push_back(symbol(currentToken));
             advance();
             return typeDef();
         }
         // 处理类型说明符
-        while (currentToken.type == TokenType::VOID || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::INT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST)
+        while (isTypeSpecifier(currentToken.type) && !hasFailed)
         {
             if (currentToken.type != TokenType::CONST)
             {
                 HasTypeSpec = true;
             }
-            typeName.push_back(currentToken.lexeme);
+            typeName.push_back(symbol(currentToken));
+            spec.add(currentToken.type);
             advance();
         }
         if (HasTypeSpec == false)
-            throwError("expected type specifier");
-        checkTypeCombination(typeName);
-        TypeSpec *typeSpec = new TypeSpec(typeName);
+            return fail("expected type specifier");
+        if (!checkTypeCombination(spec))
+            return nullptr;
+        TypeSpec *typeSpec = arena->make<TypeSpec>(typeName);
 
         if (currentToken.type == TokenType::IDENTIFIER)
         {
-            vector<string> Names;
-            Names.push_back(currentToken.lexeme);
+            vector<Symbol> Names;
+            Names.push_back(symbol(currentToken));
             tokenTypeToString(currentToken.type);
 
-            Token nextToken = lexer.peektoken();
+            Token nextToken = peek();
             if (nextToken.type == TokenType::LPAREN)
             {
                 // 函数定义或声明
 
                 ASTNode *nodetest = funcDeclOrDef(typeSpec, Names);
-                if (debug)
-                    cout << "funcDeclOrDef-parsed" << endl;
+                trace.event("funcDeclOrDef-parsed");
                 return nodetest;
             }
             else if (nextToken.type == TokenType::COMMA || nextToken.type == TokenType::SEMI || nextToken.type == TokenType::LBRACKET || nextToken.type == TokenType::ASSIGN)
@@ -1164,11 +1723,11 @@ public:
             }
             else
             {
-                throwError("unexpected token after IDENTIFIER");
+                return fail("unexpected token after IDENTIFIER");
             }
         }
         else
-            throwError("expected IDENTIFIER");
+            return fail("expected IDENTIFIER");
         return nullptr;
     }
 
@@ -1176,10 +1735,9 @@ public:
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "preprocessor " << endl;
+        trace.event("preprocessor");
         eat(TokenType::HASHTAG);
         if (currentToken.type == TokenType::INCLUDE)
         {
@@ -1189,9 +1747,11 @@ public:
             eat(TokenType::INCLUDE);
             if (currentToken.type == TokenType::STRING)
             {
-                directive += "\"" + currentToken.lexeme + "\"";
+                directive += '"';
+                directive += currentToken.lexeme;
+                directive += '"';
                 eat(TokenType::STRING);
-                return new Preprocessor(directive);
+                return arena->make<Preprocessor>(directive);
             }
             else if (currentToken.type == TokenType::LESS_THAN)
             {
@@ -1201,7 +1761,7 @@ public:
                 {
                     directive += currentToken.lexeme;
                     eat(TokenType::IDENTIFIER);
-                    while (currentToken.type == TokenType::DOT || currentToken.type == TokenType::IDENTIFIER)
+                    while (!hasFailed && (currentToken.type == TokenType::DOT || currentToken.type == TokenType::IDENTIFIER))
                     {
                         if (currentToken.type == TokenType::DOT)
                         {
@@ -1218,30 +1778,21 @@ public:
                     {
                         directive += ">";
                         eat(TokenType::GREATER_THAN);
-                        return new Preprocessor(directive);
+                        return arena->make<Preprocessor>(directive);
                     }
                     else
                     {
-                        throw std::runtime_error(
-                            "Syntax error at line " + std::to_string(currentToken.line) +
-                            ", column " + std::to_string(currentToken.column) +
-                            ": expected '>' after #include <...>");
+                        return fail("expected '>' after #include <...>");
                     }
                 }
                 else
                 {
-                    throw std::runtime_error(
-                        "Syntax error at line " + std::to_string(currentToken.line) +
-                        ", column " + std::to_string(currentToken.column) +
-                        ": expected IDENTIFIER after #include <");
+                    return fail("expected IDENTIFIER after #include <");
                 }
             }
             else
             {
-                throw std::runtime_error(
-                    "Syntax error at line " + std::to_string(currentToken.line) +
-                    ", column " + std::to_string(currentToken.column) +
-                    ": expected STRING after #include");
+                return fail("expected STRING after #include");
             }
         }
         else if (currentToken.type == TokenType::DEFINE)
@@ -1255,7 +1806,7 @@ public:
                 directive += currentToken.lexeme;
                 eat(TokenType::IDENTIFIER);
                 int line = currentToken.line;
-                while (currentToken.type != TokenType::END_OF_FILE)
+                while (currentToken.type != TokenType::END_OF_FILE && !hasFailed)
                 {
                     if (currentToken.type == TokenType::BACKSLASH)
                     {
@@ -1263,25 +1814,26 @@ public:
                         if (currentToken.type == TokenType::END_OF_FILE)
                             break;
                         if (currentToken.line == line)
-                            throwError("expected newline after '\\'");
+                            return fail("expected newline after '\\'");
                         line = currentToken.line;
                     }
                     if (currentToken.line != line)
                         break;
 
-                    directive += ' ' + currentToken.lexeme;
+                    directive += ' ';
+                    directive += currentToken.lexeme;
                     advance();
                 }
-                return new Preprocessor(directive);
+                return arena->make<Preprocessor>(directive);
             }
             else
             {
-                throwError("expected IDENTIFIER after #define");
+                return fail("expected IDENTIFIER after #define");
             }
         }
         else
         {
-            throwError("expected 'include' or 'define' after '#'");
+            return fail("expected 'include' or 'define' after '#'");
         }
         return nullptr;
     }
@@ -1290,13 +1842,12 @@ public:
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "extvaldecl" << endl;
+        trace.event("extvaldecl");
         vector<VarDeclNode *> varDecls;
-        string currentName;
-        while (currentToken.type != TokenType::SEMI)
+        Symbol currentName;
+        while (currentToken.type != TokenType::SEMI && !hasFailed)
         {
             if (currentToken.type == TokenType::SIGNAL_COMMENT || currentToken.type == TokenType::BLOCK_COMMENT)
             {
@@ -1305,18 +1856,18 @@ public:
             }
             if (currentToken.type == TokenType::IDENTIFIER)
             {
-                currentName = currentToken.lexeme;
+                currentName = symbol(currentToken);
                 eat(TokenType::IDENTIFIER);
                 if (currentToken.type == TokenType::SEMI)
                 {
-                    varDecls.push_back(new VarDeclNode(typeSpec, currentName, {}, nullptr));
+                    varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, vector<ASTNode *>(), nullptr));
                     break;
                 }
                 else if (currentToken.type == TokenType::LBRACKET)
                 {
                     // 处理数组
                     vector<ASTNode *> arraySizes;
-                    while (currentToken.type == TokenType::LBRACKET)
+                    while (currentToken.type == TokenType::LBRACKET && !hasFailed)
                     {
                         advance();
                         if (currentToken.type != TokenType::RBRACKET)
@@ -1334,18 +1885,18 @@ public:
                         advance();
                         VarInitList *initList = arrInitList();
                         // 处理数组初始化
-                        varDecls.push_back(new VarDeclNode(typeSpec, currentName, arraySizes, initList));
+                        varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, arraySizes, initList));
                         if (currentToken.type == TokenType::SEMI)
                             break;
                         else if (currentToken.type == TokenType::COMMA)
                             eat(TokenType::COMMA);
                         else
-                            throwError("unexpected token after array initialization");
+                            return fail("unexpected token after array initialization");
                     }
                     else if (currentToken.type == TokenType::COMMA || currentToken.type == TokenType::SEMI)
                     {
                         // 未初始化
-                        varDecls.push_back(new VarDeclNode(typeSpec, currentName, arraySizes, nullptr));
+                        varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, arraySizes, nullptr));
                         if (currentToken.type == TokenType::SEMI)
                             break;
                         else
@@ -1353,12 +1904,12 @@ public:
                     }
                     else
                     {
-                        throwError("expected '=' or ',' or ';' after array declaration");
+                        return fail("expected '=' or ',' or ';' after array declaration");
                     }
                 }
                 else if (currentToken.type == TokenType::COMMA)
                 {
-                    varDecls.push_back(new VarDeclNode(typeSpec, currentName, {}, nullptr));
+                    varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, vector<ASTNode *>(), nullptr));
                     // 处理多个变量声明
                     eat(TokenType::COMMA);
                     continue;
@@ -1367,91 +1918,92 @@ public:
                 {
                     advance();
                     // 处理初始化
-                    varDecls.push_back(new VarDeclNode(typeSpec, currentName, {}, Expression()));
+                    varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, vector<ASTNode *>(), Expression()));
                     if (currentToken.type == TokenType::SEMI)
                         break;
                     else if (currentToken.type == TokenType::COMMA)
                         eat(TokenType::COMMA);
                     else
-                        throwError("unexpected token after variable initialization");
+                        return fail("unexpected token after variable initialization");
                 }
                 else
                 {
-                    throwError("expected '[' or ',' or '=' or ';' after IDENTIFIER in variable declaration");
+                    return fail("expected '[' or ',' or '=' or ';' after IDENTIFIER in variable declaration");
                 }
             }
             else
             {
-                throwError("expected IDENTIFIER in variable declaration");
+                return fail("expected IDENTIFIER in variable declaration");
             }
         }
         eat(TokenType::SEMI);
-        return new ExtVarDecl(varDecls);
+        return arena->make<ExtVarDecl>(varDecls);
     }
 
     ASTNode *localVarDecl()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "localvaldecl" << endl;
-        vector<string> typeName;
-        string currentName;
+        trace.event("localvaldecl");
+        vector<Symbol> typeName;
+        TypeSpecifiers spec;
+        Symbol currentName;
         bool HasStorageClass = false, HasTypeSpec = false;
         // 处理存储类型
-        while (isStorageType(currentToken.type))
+        while (isStorageType(currentToken.type) && !hasFailed)
         {
             if (HasStorageClass && isStorageType(currentToken.type))
-                throwError("multiple storage class specifiers");
+                return fail("multiple storage class specifiers");
 
             HasStorageClass = true;
-            typeName.push_back(currentToken.lexeme);
+            typeName.push_back(symbol(currentToken));
             advance();
         }
         // 处理类型说明符
-        while (currentToken.type == TokenType::VOID || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::INT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST)
+        while (isTypeSpecifier(currentToken.type) && !hasFailed)
         {
             if (currentToken.type != TokenType::CONST)
             {
                 HasTypeSpec = true;
             }
-            typeName.push_back(currentToken.lexeme);
+            typeName.push_back(symbol(currentToken));
+            spec.add(currentToken.type);
             advance();
         }
         if (HasTypeSpec == false)
-            throwError("expected type specifier");
-        checkTypeCombination(typeName);
-        TypeSpec *typeSpec = new TypeSpec(typeName);
+            return fail("expected type specifier");
+        if (!checkTypeCombination(spec))
+            return nullptr;
+        TypeSpec *typeSpec = arena->make<TypeSpec>(typeName);
         if (currentToken.type != TokenType::IDENTIFIER)
         {
-            throwError("expected IDENTIFIER in variable declaration");
+            return fail("expected IDENTIFIER in variable declaration");
         }
 
         vector<VarDeclNode *> varDecls;
-        while (currentToken.type != TokenType::SEMI)
+        while (currentToken.type != TokenType::SEMI && !hasFailed)
         {
             if (currentToken.type == TokenType::IDENTIFIER)
             {
-                currentName = currentToken.lexeme;
+                currentName = symbol(currentToken);
                 eat(TokenType::IDENTIFIER);
                 if (currentToken.type == TokenType::SEMI)
                 {
-                    varDecls.push_back(new VarDeclNode(typeSpec, currentName, {}, nullptr));
+                    varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, vector<ASTNode *>(), nullptr));
                     break;
                 }
                 else if (currentToken.type == TokenType::LBRACKET)
                 {
                     // 处理数组
                     vector<ASTNode *> arraySizes;
-                    while (currentToken.type == TokenType::LBRACKET)
+                    while (currentToken.type == TokenType::LBRACKET && !hasFailed)
                     {
                         advance();
                         if (currentToken.type != TokenType::RBRACKET)
                         {
                             arraySizes.push_back(Expression());
-                            // if(debug) printToken(currentToken);
                         }
                         else
                         {
@@ -1464,7 +2016,7 @@ public:
                         advance();
                         VarInitList *initList = arrInitList();
                         // 处理数组初始化
-                        varDecls.push_back(new VarDeclNode(typeSpec, currentName, arraySizes, initList));
+                        varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, arraySizes, initList));
                         if (currentToken.type == TokenType::SEMI)
                         {
                             break;
@@ -1472,12 +2024,12 @@ public:
                         else if (currentToken.type == TokenType::COMMA)
                             eat(TokenType::COMMA);
                         else
-                            throwError("unexpected token after array initialization");
+                            return fail("unexpected token after array initialization");
                     }
                     else if (currentToken.type == TokenType::COMMA || currentToken.type == TokenType::SEMI)
                     {
                         // 未初始化
-                        varDecls.push_back(new VarDeclNode(typeSpec, currentName, arraySizes, nullptr));
+                        varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, arraySizes, nullptr));
                         if (currentToken.type == TokenType::SEMI)
                         {
                             eat(TokenType::SEMI);
@@ -1488,12 +2040,12 @@ public:
                     }
                     else
                     {
-                        throwError("expected '=' or ',' or ';' after array declaration");
+                        return fail("expected '=' or ',' or ';' after array declaration");
                     }
                 }
                 else if (currentToken.type == TokenType::COMMA)
                 {
-                    varDecls.push_back(new VarDeclNode(typeSpec, currentName, {}, nullptr));
+                    varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, vector<ASTNode *>(), nullptr));
                     // 处理多个变量声明
                     eat(TokenType::COMMA);
                 }
@@ -1501,51 +2053,47 @@ public:
                 {
                     advance();
                     // 处理初始化
-                    varDecls.push_back(new VarDeclNode(typeSpec, currentName, {}, Expression()));
+                    varDecls.push_back(arena->make<VarDeclNode>(typeSpec, currentName, vector<ASTNode *>(), Expression()));
                     if (currentToken.type == TokenType::SEMI)
                         break;
                     else if (currentToken.type == TokenType::COMMA)
                         eat(TokenType::COMMA);
                     else
-                        throwError("unexpected token after variable initialization");
+                        return fail("unexpected token after variable initialization");
                 }
                 else
                 {
-                    throwError("expected '[' or ',' or '=' or ';' after IDENTIFIER in variable declaration");
+                    return fail("expected '[' or ',' or '=' or ';' after IDENTIFIER in variable declaration");
                 }
             }
             else
             {
-                throwError("expected IDENTIFIER in variable declaration");
+                return fail("expected IDENTIFIER in variable declaration");
             }
         }
-        return new LocalVarDecl(varDecls);
+        return arena->make<LocalVarDecl>(varDecls);
     }
 
-    ASTNode *funcDeclOrDef(TypeSpec *FuncReturnType, vector<string> &FuncNames)
+    ASTNode *funcDeclOrDef(TypeSpec *FuncReturnType, vector<Symbol> &FuncNames)
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "fundeclordef" << endl;
+        trace.event("fundeclordef");
         eat(TokenType::IDENTIFIER);
         eat(TokenType::LPAREN);
-        vector<vector<pair<TypeSpec *, string>>> allParams;
-        vector<pair<TypeSpec *, string>> params;
+        vector<vector<pair<TypeSpec *, Symbol>>> allParams;
+        vector<pair<TypeSpec *, Symbol>> params;
 
-        while (currentToken.type != TokenType::RPAREN)
+        while (currentToken.type != TokenType::RPAREN && !hasFailed)
         {
-            if (debug)
-            {
-                cout << "parsing params for func " << FuncNames.back() << ":\n  ";
-                printToken(currentToken);
-            }
+            trace.token("params", currentToken);
             bool HasTypeSpec = false, HasVoidType = false;
-            vector<string> paramTypeName;
+            vector<Symbol> paramTypeName;
+            TypeSpecifiers paramSpec;
             // 处理参数类型说明符
-            while (currentToken.type == TokenType::VOID || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::INT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST)
+            while (isTypeSpecifier(currentToken.type) && !hasFailed)
             {
                 if (currentToken.type != TokenType::CONST)
                 {
@@ -1555,28 +2103,30 @@ public:
                     HasVoidType = true;
                 if (currentToken.type == TokenType::VOID && paramTypeName.size() > 0)
                 {
-                    throwError("'void' must be the only type specifier in parameter");
+                    return fail("'void' must be the only type specifier in parameter");
                 }
-                paramTypeName.push_back(currentToken.lexeme);
+                paramTypeName.push_back(symbol(currentToken));
+                paramSpec.add(currentToken.type);
                 advance();
             }
             // printToken(currentToken);
             if (HasTypeSpec == false)
             {
-                throwError("expected type specifier in function parameter");
+                return fail("expected type specifier in function parameter");
             }
             if (HasVoidType && paramTypeName.size() > 1)
-                throwError("'void' must be the only type specifier in parameter");
-            checkTypeCombination(paramTypeName);
-            TypeSpec *paramTypeSpec = new TypeSpec(paramTypeName);
+                return fail("'void' must be the only type specifier in parameter");
+            if (!checkTypeCombination(paramSpec))
+                return nullptr;
+            TypeSpec *paramTypeSpec = arena->make<TypeSpec>(paramTypeName);
 
             // 处理参数名
-            if (paramTypeName.size() == 1 && paramTypeName[0] == "void")
+            if (paramTypeName.size() == 1 && paramTypeName[0] == fixedSymbols.of(TokenType::VOID))
             {
                 // 参数类型为void，表示无参数
                 if (currentToken.type != TokenType::RPAREN)
                 {
-                    throwError("expected ')' after 'void' in function parameter");
+                    return fail("expected ')' after 'void' in function parameter");
                 }
                 allParams.push_back(params);
                 break;
@@ -1584,13 +2134,13 @@ public:
 
             else if (currentToken.type == TokenType::IDENTIFIER)
             {
-                string paramName = currentToken.lexeme;
+                Symbol paramName = symbol(currentToken);
                 eat(TokenType::IDENTIFIER);
                 params.push_back({paramTypeSpec, paramName});
             }
             else
             {
-                throwError("expected IDENTIFIER in function parameter");
+                return fail("expected IDENTIFIER in function parameter");
             }
 
             if (currentToken.type == TokenType::COMMA)
@@ -1601,48 +2151,39 @@ public:
         eat(TokenType::RPAREN);
         allParams.push_back(params);
         params.clear();
-        if (debug)
-        {
-            cout << "allparams parsed" << endl;
-            printToken(currentToken);
-        }
+        trace.token("allparams parsed", currentToken);
         if (currentToken.type == TokenType::SEMI)
         {
             // 函数声明
             eat(TokenType::SEMI);
-            if (debug)
-                cout << FuncNames.size() << " function names parsed" << endl;
-            return new FuncionDeclNode(FuncReturnType, FuncNames, allParams);
+            trace.event("function names parsed", FuncNames.size());
+            return arena->make<FuncionDeclNode>(FuncReturnType, FuncNames, allParams);
         }
         else if (currentToken.type == TokenType::COMMA)
         {
             // 函数声明，多个函数名
-            while (currentToken.type == TokenType::COMMA)
+            while (currentToken.type == TokenType::COMMA && !hasFailed)
             {
                 eat(TokenType::COMMA);
                 if (currentToken.type == TokenType::IDENTIFIER)
                 {
-                    FuncNames.push_back(currentToken.lexeme);
-                    if (debug)
-                        cout << "fun number: " << FuncNames.size() << endl;
+                    FuncNames.push_back(symbol(currentToken));
+                    trace.event("fun number", FuncNames.size());
                     eat(TokenType::IDENTIFIER);
                 }
                 else
                 {
-                    throwError("expected IDENTIFIER after ',' in function declaration");
+                    return fail("expected IDENTIFIER after ',' in function declaration");
                 }
                 eat(TokenType::LPAREN);
-                while (currentToken.type != TokenType::RPAREN)
+                while (currentToken.type != TokenType::RPAREN && !hasFailed)
                 {
-                    if (debug)
-                    {
-                        cout << "parsing params for func " << FuncNames.back() << endl;
-                        printToken(currentToken);
-                    }
+                    trace.token("params", currentToken);
                     bool HasTypeSpec = false, HasVoidType = false;
-                    vector<string> paramTypeName;
+                    vector<Symbol> paramTypeName;
+                    TypeSpecifiers paramSpec;
                     // 处理参数类型说明符
-                    while (currentToken.type == TokenType::VOID || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::INT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST)
+                    while (isTypeSpecifier(currentToken.type) && !hasFailed)
                     {
                         if (currentToken.type != TokenType::CONST)
                         {
@@ -1652,28 +2193,30 @@ public:
                             HasVoidType = true;
                         if (currentToken.type == TokenType::VOID && paramTypeName.size() > 0)
                         {
-                            throwError("'void' must be the only type specifier in parameter");
+                            return fail("'void' must be the only type specifier in parameter");
                         }
-                        paramTypeName.push_back(currentToken.lexeme);
+                        paramTypeName.push_back(symbol(currentToken));
+                        paramSpec.add(currentToken.type);
                         advance();
                     }
                     // printToken(currentToken);
                     if (HasTypeSpec == false)
                     {
-                        throwError("expected type specifier in function parameter");
+                        return fail("expected type specifier in function parameter");
                     }
                     if (HasVoidType && paramTypeName.size() > 1)
-                        throwError("'void' must be the only type specifier in parameter");
-                    checkTypeCombination(paramTypeName);
-                    TypeSpec *paramTypeSpec = new TypeSpec(paramTypeName);
+                        return fail("'void' must be the only type specifier in parameter");
+                    if (!checkTypeCombination(paramSpec))
+                        return nullptr;
+                    TypeSpec *paramTypeSpec = arena->make<TypeSpec>(paramTypeName);
 
                     // 处理参数名
-                    if (paramTypeName.size() == 1 && paramTypeName[0] == "void")
+                    if (paramTypeName.size() == 1 && paramTypeName[0] == fixedSymbols.of(TokenType::VOID))
                     {
                         // 参数类型为void，表示无参数
                         if (currentToken.type != TokenType::RPAREN)
                         {
-                            throwError("expected ')' after 'void' in function parameter");
+                            return fail("expected ')' after 'void' in function parameter");
                         }
                         allParams.push_back(params);
                         break;
@@ -1681,13 +2224,13 @@ public:
 
                     else if (currentToken.type == TokenType::IDENTIFIER)
                     {
-                        string paramName = currentToken.lexeme;
+                        Symbol paramName = symbol(currentToken);
                         eat(TokenType::IDENTIFIER);
                         params.push_back({paramTypeSpec, paramName});
                     }
                     else
                     {
-                        throwError("expected IDENTIFIER in function parameter");
+                        return fail("expected IDENTIFIER in function parameter");
                     }
 
                     if (currentToken.type == TokenType::COMMA)
@@ -1698,41 +2241,30 @@ public:
                 eat(TokenType::RPAREN);
                 allParams.push_back(params);
                 params.clear();
-                if (debug)
-                {
-                    cout << "allparams parsed" << endl;
-                    printToken(currentToken);
-                }
+                trace.token("allparams parsed", currentToken);
             }
             eat(TokenType::SEMI);
-            return new FuncionDeclNode(FuncReturnType, FuncNames, allParams);
+            return arena->make<FuncionDeclNode>(FuncReturnType, FuncNames, allParams);
         }
         else if (currentToken.type == TokenType::LBRACE)
         {
             // 函数定义
             ASTNode *body = compoundStmt();
-            if (debug)
-            {
-                cout << "func-body-parsed" << endl;
-                if (FuncNames.size() == 0)
-                {
-                    throwError("function must have a name");
-                }
-            }
+            trace.event("func-body-parsed");
             if (allParams.size() == 0)
             {
                 allParams.push_back({}); // 无参数
             }
             if (FuncNames.size() == 0)
             {
-                throwError("function must have a name");
+                return fail("function must have a name");
             }
 
-            return new FunctionDef(FuncReturnType, FuncNames[0], allParams[0], body);
+            return arena->make<FunctionDef>(FuncReturnType, FuncNames[0], allParams[0], body);
         }
         else
         {
-            throwError("unexpected token after function parameter list");
+            return fail("unexpected token after function parameter list");
         }
         return nullptr;
     }
@@ -1741,84 +2273,100 @@ public:
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "typedef" << endl;
+        trace.event("typedef");
         bool HasTypeSpec = false;
-        vector<string> typeName;
+        vector<Symbol> typeName;
+        TypeSpecifiers spec;
 
-        while (currentToken.type == TokenType::VOID || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::INT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST)
+        while (isTypeSpecifier(currentToken.type) && !hasFailed)
         {
             if (currentToken.type != TokenType::CONST)
             {
                 HasTypeSpec = true;
             }
-            typeName.push_back(currentToken.lexeme);
+            typeName.push_back(symbol(currentToken));
+            spec.add(currentToken.type);
             advance();
         }
         if (isStorageType(currentToken.type))
-            throwError("storage class specifier cannot appear after typedef");
+            return fail("storage class specifier cannot appear after typedef");
         if (HasTypeSpec == false)
-            throwError("expected type specifier");
-        checkTypeCombination(typeName);
-        TypeSpec *typeSpec = new TypeSpec(typeName);
+            return fail("expected type specifier");
+        if (!checkTypeCombination(spec))
+            return nullptr;
+        TypeSpec *typeSpec = arena->make<TypeSpec>(typeName);
         bool hasTypeDefName = false;
-        while (currentToken.type == TokenType::IDENTIFIER)
+        while (currentToken.type == TokenType::IDENTIFIER && !hasFailed)
         {
-            vector<string> typeDefName;
-            typeDefName.push_back(currentToken.lexeme);
+            vector<Symbol> typeDefName;
+            typeDefName.push_back(symbol(currentToken));
             eat(TokenType::IDENTIFIER);
             eat(TokenType::SEMI);
-            return new TypeDefNode(typeSpec, typeDefName);
+            return arena->make<TypeDefNode>(typeSpec, typeDefName);
         }
         if (hasTypeDefName == false)
-            throwError("expected IDENTIFIER after typedef");
+            return fail("expected IDENTIFIER after typedef");
         return nullptr;
     }
 
     ASTNode *compoundStmt()
     {
+        if (hasFailed)
+            return nullptr;
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "compoundstmt" << endl;
+        trace.event("compoundstmt");
+        const char *begin = tokenBegin(currentToken);
         eat(TokenType::LBRACE);
+        int indent = blockIndent;
+        blockIndent = indent + 1;
         vector<ASTNode *> localDecls;
         vector<ASTNode *> statements;
-        while (currentToken.type != TokenType::RBRACE)
+        while (currentToken.type != TokenType::RBRACE && !hasFailed)
         {
-            if (currentToken.type == TokenType::INT || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST || isStorageType(currentToken.type))
-            {
-                statements.push_back(localVarDecl());
-                eat(TokenType::SEMI);
-            }
-            else
+            const char *stmtBegin = tokenBegin(currentToken);
+            ASTNode *stmt = blockStatement([this]() -> ASTNode *
             {
-                statements.push_back(statement(false));
-            }
+                if (currentToken.type == TokenType::INT || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST || isStorageType(currentToken.type))
+                {
+                    ASTNode *decl = localVarDecl();
+                    eat(TokenType::SEMI);
+                    return decl;
+                }
+                return statement(false);
+            });
+            if (stmt)
+                stmt->setSource(stmtBegin, consumedEnd);
+            statements.push_back(stmt);
         }
+        blockIndent = indent;
         eat(TokenType::RBRACE);
-        return new CompoundStmt(statements);
+        auto block = arena->make<CompoundStmt>(statements);
+        block->setSource(begin, consumedEnd);
+        block->childIndent = indent + 1;
+        if (blocks)
+            blocks->push_back(block);
+        return block;
     }
 
+    // 出错后 advance() 不再前进，递归的产生式在入口处返回，避免在同一个 token 上反复进入
     ASTNode *statement(bool isInParen)
     {
+        if (hasFailed)
+            return nullptr;
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
         if (currentToken.type == TokenType::END_OF_FILE)
         {
-            throwError("unexpected end of file in statement");
-        }
-        if (debug)
-        {
-            cout << "statement ";
-            printToken(currentToken);
+            return fail("unexpected end of file in statement");
         }
+        trace.token("statement", currentToken);
         if (currentToken.type == TokenType::IF)
         {
             return ifStatement();
@@ -1858,21 +2406,20 @@ public:
         else if (currentToken.type == TokenType::SEMI)
         {
             eat(TokenType::SEMI);
-            return new EmptyStmt(); // 空语句
+            return arena->make<EmptyStmt>(); // 空语句
         }
         else if (currentToken.type == TokenType::VOID)
         {
-            throwError("variable cannot be of type void");
+            return fail("variable cannot be of type void");
         }
         else if (currentToken.type == TokenType::INT || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST || currentToken.type == TokenType::STATIC || currentToken.type == TokenType::EXTERN || currentToken.type == TokenType::REGISTER)
         {
-            if (debug)
-                printToken(currentToken);
+            trace.token("statement-localvar", currentToken);
             return localVarDecl();
         }
         else if (currentToken.type == TokenType::IDENTIFIER)
         {
-            Token nextToken = lexer.peektoken();
+            Token nextToken = peek();
             if (nextToken.type == TokenType::ASSIGN || nextToken.type == TokenType::ADD_ASSIGN || nextToken.type == TokenType::SUB_ASSIGN || nextToken.type == TokenType::MUL_ASSIGN || nextToken.type == TokenType::DIV_ASSIGN || nextToken.type == TokenType::MOD_ASSIGN || nextToken.type == TokenType::AND_ASSIGN || nextToken.type == TokenType::OR_ASSIGN || nextToken.type == TokenType::BITWISE_XOR_ASSIGN || nextToken.type == TokenType::LEFT_SHIFT_ASSIGN || nextToken.type == TokenType::RIGHT_SHIFT_ASSIGN || nextToken.type == TokenType::BITWISE_AND_ASSIGN || nextToken.type == TokenType::BITWISE_OR_ASSIGN)
             {
                 auto assignstmt = assignExpression();
@@ -1884,14 +2431,16 @@ public:
             }
             else if (nextToken.type == TokenType::LBRACKET)
             {
-                string varName = currentToken.lexeme;
+                string varName = currentToken.lexeme.str();
                 eat(TokenType::IDENTIFIER);
-                while (currentToken.type == TokenType::LBRACKET)
+                while (currentToken.type == TokenType::LBRACKET && !hasFailed)
                 {
                     varName += "[";
                     eat(TokenType::LBRACKET);
-                    while (currentToken.type != TokenType::RBRACKET)
+                    while (currentToken.type != TokenType::RBRACKET && !hasFailed)
                     {
+                        if (currentToken.type == TokenType::END_OF_FILE)
+                            return fail("unexpected end of file in array subscript");
                         varName += currentToken.lexeme;
                         advance();
                     }
@@ -1900,18 +2449,18 @@ public:
                 }
                 if (currentToken.type == TokenType::ASSIGN || currentToken.type == TokenType::ADD_ASSIGN || currentToken.type == TokenType::SUB_ASSIGN || currentToken.type == TokenType::MUL_ASSIGN || nextToken.type == TokenType::DIV_ASSIGN || currentToken.type == TokenType::MOD_ASSIGN || currentToken.type == TokenType::AND_ASSIGN || currentToken.type == TokenType::OR_ASSIGN || currentToken.type == TokenType::BITWISE_XOR_ASSIGN || currentToken.type == TokenType::LEFT_SHIFT_ASSIGN || currentToken.type == TokenType::RIGHT_SHIFT_ASSIGN || currentToken.type == TokenType::BITWISE_AND_ASSIGN || currentToken.type == TokenType::BITWISE_OR_ASSIGN)
                 {
-                    auto assignOp = currentToken.lexeme;
+                    Symbol assignOp = symbol(currentToken);
                     advance(); // 吃掉赋值运算符
                     auto expr = Expression();
                     if (!isInParen)
                     {
                         eat(TokenType::SEMI);
                     }
-                    return new AssignExpr(varName, assignOp, expr);
+                    return arena->make<AssignExpr>(arena->intern(varName), assignOp, expr);
                 }
                 else
                 {
-                    throwError("expected '=' after array variable");
+                    return fail("expected '=' after array variable");
                 }
             }
             else
@@ -1925,7 +2474,7 @@ public:
             }
         }
 
-        else if (find(constants.begin(), constants.end(), currentToken.type) != constants.end())
+        else if (isOperandToken(currentToken.type))
         {
             auto expr = Expression();
             if (!isInParen)
@@ -1939,15 +2488,14 @@ public:
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "ifstmt" << endl;
+        trace.event("ifstmt");
         eat(TokenType::IF);
         eat(TokenType::LPAREN);
         ASTNode *condition = ExpressionInFuncCall();
         if (condition == nullptr)
-            throwError("expected expression in if condition");
+            return fail("expected expression in if condition");
         eat(TokenType::RPAREN);
         ASTNode *thenBranch = nullptr;
         if (currentToken.type == TokenType::LBRACE)
@@ -1958,7 +2506,7 @@ public:
         {
             thenBranch = statement(false);
             if (thenBranch == nullptr)
-                throwError("expected statement after if condition");
+                return fail("expected statement after if condition");
         }
         ASTNode *elseBranch = nullptr;
         if (currentToken.type == TokenType::ELSE)
@@ -1978,17 +2526,16 @@ public:
             }
         }
 
-        return new IfStmt(condition, thenBranch, elseBranch);
+        return arena->make<IfStmt>(condition, thenBranch, elseBranch);
     }
 
     ASTNode *whileStatement()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "whilestmt" << endl;
+        trace.event("whilestmt");
         ASTNode *condition = nullptr;
         eat(TokenType::WHILE);
         eat(TokenType::LPAREN);
@@ -2003,17 +2550,16 @@ public:
         {
             body = statement(false);
         }
-        return new WhileStmt(condition, body);
+        return arena->make<WhileStmt>(condition, body);
     }
 
     ASTNode *doWhileStatement()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "dowhilestmt" << endl;
+        trace.event("dowhilestmt");
         eat(TokenType::DO);
         ASTNode *body = nullptr;
         if (currentToken.type == TokenType::LBRACE)
@@ -2026,37 +2572,32 @@ public:
         }
         eat(TokenType::WHILE);
         if (currentToken.type != TokenType::LPAREN)
-            throwError("expected '(' after 'while'");
+            return fail("expected '(' after 'while'");
         ASTNode *condition = Expression();
         eat(TokenType::SEMI);
-        return new DoWhileStmt(body, condition);
+        return arena->make<DoWhileStmt>(body, condition);
     }
 
     ASTNode *forStatement()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "forstmt" << endl;
+        trace.event("forstmt");
         eat(TokenType::FOR);
         eat(TokenType::LPAREN);
         ASTNode *init = nullptr;
         ASTNode *condition = nullptr;
         ASTNode *increment = nullptr;
         ASTNode *body = nullptr;
-        Token nextToken = lexer.peektoken();
+        Token nextToken = peek();
         if (currentToken.type != TokenType::SEMI)
         {
             if (currentToken.type == TokenType::INT || currentToken.type == TokenType::CHAR || currentToken.type == TokenType::SHORT || currentToken.type == TokenType::LONG || currentToken.type == TokenType::FLOAT || currentToken.type == TokenType::DOUBLE || currentToken.type == TokenType::UNSIGNED || currentToken.type == TokenType::SIGNED || currentToken.type == TokenType::CONST || isStorageType(currentToken.type))
             {
-                if (debug)
-                {
-                    cout << "for-init-localvar";
-                    printToken(currentToken);
-                    printToken(nextToken);
-                }
+                trace.token("for-init-localvar", currentToken);
+                trace.token("for-init-localvar-next", nextToken);
                 init = statement(false);
                 eat(TokenType::SEMI);
             }
@@ -2081,37 +2622,34 @@ public:
         {
             body = statement(false);
         }
-        return new ForStmt(init, condition, increment, body);
+        return arena->make<ForStmt>(init, condition, increment, body);
     }
 
     ASTNode *returnStatement()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "returnstmt" << endl;
+        trace.event("returnstmt");
         eat(TokenType::RETURN);
         ASTNode *expr = nullptr;
         if (currentToken.type != TokenType::SEMI)
         {
             expr = Expression();
-            if (debug)
-                cout << "return-expr-parsed" << endl;
+            trace.event("return-expr-parsed");
         }
         eat(TokenType::SEMI);
-        return new ReturnStmt(expr);
+        return arena->make<ReturnStmt>(expr);
     }
 
     ASTNode *SwitchStatement()
     {
         if (currentToken.type == TokenType::ERROR)
         {
-            throwError("invalid token: " + currentToken.lexeme);
+            return fail("invalid token: " + currentToken.lexeme);
         }
-        if (debug)
-            cout << "switchstmt" << endl;
+        trace.event("switchstmt");
         eat(TokenType::SWITCH);
         eat(TokenType::LPAREN);
         auto expr = Expression();
@@ -2119,7 +2657,7 @@ public:
         eat(TokenType::LBRACE);
         vector<ASTNode *> cases;
         ASTNode *defaultCase = nullptr;
-        while (currentToken.type != TokenType::RBRACE)
+        while (currentToken.type != TokenType::RBRACE && !hasFailed)
         {
             if (currentToken.type == TokenType::CASE)
             {
@@ -2127,73 +2665,75 @@ public:
                 auto caseExpr = Expression();
                 eat(TokenType::COLON);
                 vector<ASTNode *> stmts;
-                while (currentToken.type != TokenType::CASE && currentToken.type != TokenType::DEFAULT && currentToken.type != TokenType::RBRACE)
+                blockIndent += 2;
+                while (currentToken.type != TokenType::CASE && currentToken.type != TokenType::DEFAULT && currentToken.type != TokenType::RBRACE && !hasFailed)
                 {
-                    auto stmt = statement(false);
+                    auto stmt = blockStatement([this]() { return statement(false); });
                     if (stmt)
                         stmts.push_back(stmt);
                 }
-                cases.push_back(new SwitchCase(caseExpr, stmts));
+                blockIndent -= 2;
+                cases.push_back(arena->make<SwitchCase>(caseExpr, stmts));
             }
             else if (currentToken.type == TokenType::DEFAULT)
             {
                 eat(TokenType::DEFAULT);
                 eat(TokenType::COLON);
                 vector<ASTNode *> stmts;
-                while (currentToken.type != TokenType::RBRACE)
+                blockIndent += 2;
+                while (currentToken.type != TokenType::RBRACE && !hasFailed)
                 {
-                    auto stmt = statement(false);
+                    auto stmt = blockStatement([this]() { return statement(false); });
                     if (stmt)
                         stmts.push_back(stmt);
                 }
+                blockIndent -= 2;
                 if (defaultCase)
-                    throwError("multiple default cases in switch");
-                defaultCase = new DefaultCase(stmts);
+                    return fail("multiple default cases in switch");
+                defaultCase = arena->make<DefaultCase>(stmts);
             }
             else
             {
-                throwError("expected 'case' or 'default' in switch statement");
+                return fail("expected 'case' or 'default' in switch statement");
             }
         }
         eat(TokenType::RBRACE);
-        return new SwitchStmt(expr, cases, defaultCase);
+        return arena->make<SwitchStmt>(expr, cases, defaultCase);
     }
 
     ASTNode *BreakStatement()
     {
-        if (debug)
-            cout << "breakstmt" << endl;
+        trace.event("breakstmt");
         eat(TokenType::BREAK);
         eat(TokenType::SEMI);
-        return new BreakStmt();
+        return arena->make<BreakStmt>();
     }
 
     ASTNode *ContinueStatement()
     {
-        if (debug)
-            cout << "continuestmt" << endl;
+        trace.event("continuestmt");
         eat(TokenType::CONTINUE);
         eat(TokenType::SEMI);
-        return new ContinueStmt();
+        return arena->make<ContinueStmt>();
     }
 
     ASTNode *assignExpression()
     {
-        if (debug)
-            cout << "assignexpression" << endl;
-        string indentifier = currentToken.lexeme;
+        trace.event("assignexpression");
+        Symbol indentifier = symbol(currentToken);
         eat(TokenType::IDENTIFIER);
-        auto op = currentToken.lexeme;
+        Symbol op = symbol(currentToken);
         advance(); // 处理赋值运算符
         auto expr = Expression();
-        return new AssignExpr(indentifier, op, expr);
+        return arena->make<AssignExpr>(indentifier, op, expr);
     }
 
     FuncCallExpr *funcCall(Token nextToken)
     {
-        if (debug)
-            cout << "funccall" << endl;
-        string funcName = currentToken.lexeme;
+        if (hasFailed)
+            return nullptr;
+        trace.event("funccall");
+        Symbol funcName = symbol(currentToken);
         eat(TokenType::IDENTIFIER);
         currentToken = nextToken;
         eat(TokenType::LPAREN);
@@ -2201,410 +2741,113 @@ public:
         if (currentToken.type != TokenType::RPAREN)
         {
             args.push_back(ExpressionInFuncCall());
-            while (currentToken.type == TokenType::COMMA)
+            while (currentToken.type == TokenType::COMMA && !hasFailed)
             {
                 eat(TokenType::COMMA);
                 args.push_back(ExpressionInFuncCall());
             }
         }
         eat(TokenType::RPAREN);
-        if (debug)
-            cout << "func-call-parsed" << endl;
-        return new FuncCallExpr(funcName, args);
+        trace.event("func-call-parsed");
+        return arena->make<FuncCallExpr>(funcName, args);
     }
 
+    // 语句、初始化器、数组维度中的表达式：遇到任何不能继续表达式的 token 即结束
     ASTNode *Expression()
     {
-        if (debug)
-        {
-            cout << "expression ";
-            printToken(currentToken);
-        }
-        const vector<TokenType> operators = {
-            TokenType::OR,
-            TokenType::AND,
-            TokenType::BITWISE_OR,
-            TokenType::BITWISE_XOR,
-            TokenType::BITWISE_AND,
-            TokenType::EQUAL,
-            TokenType::NOT_EQUAL,
-            TokenType::LESS_THAN,
-            TokenType::LESS_EQUAL,
-            TokenType::GREATER_THAN,
-            TokenType::GREATER_EQUAL,
-            TokenType::LEFT_SHIFT,
-            TokenType::RIGHT_SHIFT,
-            TokenType::ADD,
-            TokenType::SUB,
-            TokenType::MUL,
-            TokenType::DIV,
-            TokenType::MOD,
-        };
-
-        const unordered_map<string, int> opPrecedence = {
-            {"||", 1},
-            {"&&", 2},
-            {"|", 3},
-            {"^", 4},
-            {"&", 5},
-            {"==", 6},
-            {"!=", 6},
-            {"<", 7},
-            {"<=", 7},
-            {">", 7},
-            {">=", 7},
-            {"<<", 8},
-            {">>", 8},
-            {"+", 9},
-            {"-", 9},
-            {"*", 10},
-            {"/", 10},
-            {"%", 10},
-            {"(", 0} // 用于处理括号
-        };
-
-        stack<BinaryExpr *> opStack;
-        stack<BinaryExpr *> valStack;
-        BinaryExpr *root = nullptr;
-        do
-        {
-            if (debug)
-                printToken(currentToken);
-            if (find(constants.begin(), constants.end(), currentToken.type) != constants.end() || currentToken.type == TokenType::IDENTIFIER)
-            {
-                // 处理操作数
-                Token nextToken = lexer.peektoken();
-                if (currentToken.type == TokenType::IDENTIFIER)
-                {
-                    if (nextToken.type == TokenType::LPAREN)
-                    {
-                        valStack.push(new BinaryExpr(nullptr, nullptr, funcCall(nextToken)));
-                        continue;
-                    }
-                    else if (nextToken.type == TokenType::LBRACKET)
-                    {
-                        // 处理数组变量
-                        string varName = currentToken.lexeme;
-                        eat(TokenType::IDENTIFIER);
-                        while (currentToken.type == TokenType::LBRACKET)
-                        {
-                            varName += "[";
-                            eat(TokenType::LBRACKET);
-                            while (currentToken.type != TokenType::RBRACKET)
-                            {
-                                varName += currentToken.lexeme;
-                                advance();
-                            }
-                            varName += "]";
-                            eat(TokenType::RBRACKET);
-                        }
-                        valStack.push(new BinaryExpr(nullptr, nullptr, varName));
-                        continue;
-                    }
-                }
-                if (currentToken.type == TokenType::CHAR_CONST)
-                {
-                    valStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme, false, true));
-                }
-                else if (currentToken.type == TokenType::STRING)
-                {
-                    valStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme, true, false));
-                }
-                else
-                    valStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme));
-                advance();
-            }
-            else if (find(operators.begin(), operators.end(), currentToken.type) != operators.end())
-            {
-                // 处理操作符
-                while (!opStack.empty() && opPrecedence.at(opStack.top()->op) >= opPrecedence.at(currentToken.lexeme))
-                {
-                    // 处理栈顶运算符
-                    auto opNode = opStack.top();
-                    opStack.pop();
-                    if (valStack.size() < 2)
-                    {
-                        throwError("insufficient values for operator " + opNode->op);
-                    }
-                    auto right = valStack.top();
-                    valStack.pop();
-                    auto left = valStack.top();
-                    valStack.pop();
-                    opNode->left = left;
-                    opNode->right = right;
-                    valStack.push(opNode);
-                }
-                // 将当前运算符入栈
-                opStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme));
-                advance();
-            }
-            else if (currentToken.type == TokenType::LPAREN)
-            {
-                // 处理左括号
-                opStack.push(new BinaryExpr(nullptr, nullptr, "("));
-                advance();
-            }
-            else if (currentToken.type == TokenType::RPAREN)
-            {
-                // 处理右括号
-                while (!opStack.empty() && opStack.top()->op != "(")
-                {
-                    auto opNode = opStack.top();
-                    opStack.pop();
-                    if (valStack.size() < 2)
-                    {
-                        throwError("insufficient values for operator " + opNode->op);
-                    }
-                    auto right = valStack.top();
-                    valStack.pop();
-                    auto left = valStack.top();
-                    valStack.pop();
-                    opNode->left = left;
-                    opNode->right = right;
-                    valStack.push(opNode);
-                }
-                if (opStack.empty() || opStack.top()->op != "(")
-                {
-                    // throwError("mismatched parentheses");
-                    break;
-                }
+        return parseExpression(nullptr);
+    }
 
-                opStack.pop(); // 弹出左括号
-                advance();
-            }
-            else if (currentToken.type == TokenType::SEMI || currentToken.type == TokenType::COMMA || currentToken.type == TokenType::RBRACKET || currentToken.type == TokenType::RBRACE)
-            {
-                // 表达式结束
-                if (debug)
-                    cout << "expression-end" << endl;
-                break;
-            }
-            else
-            {
-                // throwError("unexpected token in expression: " + tokenTypeToString(currentToken.type));
-                break;
-            }
-        } while (true);
-        while (!opStack.empty())
-        {
-            // 处理剩余的运算符
-            auto opNode = opStack.top();
-            opStack.pop();
-            if (valStack.size() < 2)
-            {
-                throwError("insufficient values for operator " + opNode->op);
-            }
-            auto right = valStack.top();
-            valStack.pop();
-            auto left = valStack.top();
-            valStack.pop();
-            opNode->left = left;
-            opNode->right = right;
-            valStack.push(opNode);
-        }
-        if (valStack.size() != 1)
+    // 函数实参以及 if/while 条件中的表达式：只能在 ; , ] } ) 处结束
+    ASTNode *ExpressionInFuncCall()
+    {
+        return parseExpression(exprTables.argumentEnd);
+    }
+
+    // 统一的表达式入口，terminators 为允许结束表达式的 token 集合（以 TokenType 为下标），
+    // 为 nullptr 时不做限制，由调用者检查后续 token
+    ASTNode *parseExpression(const bool *terminators)
+    {
+        trace.token("expression", currentToken);
+        ASTNode *expr = binaryExpression(1, terminators);
+        if (terminators && !terminators[static_cast<size_t>(currentToken.type)])
+            return fail("unexpected token in expression: " + tokenTypeToString(currentToken.type));
+        return expr;
+    }
+
+    // 优先级爬升：先解析一个操作数，再吸收优先级不低于 minPrecedence 的二元运算符（左结合）
+    // 只为真正的运算符创建节点，括号只影响结合方式，不产生节点
+    BinaryExpr *binaryExpression(int minPrecedence, const bool *terminators)
+    {
+        BinaryExpr *left = primaryExpression(terminators);
+        for (int precedence = binaryPrecedence(currentToken.type); precedence >= minPrecedence && !hasFailed; precedence = binaryPrecedence(currentToken.type))
         {
-            throwError("invalid expression");
+            Symbol op = symbol(currentToken);
+            advance();
+            BinaryExpr *right = binaryExpression(precedence + 1, terminators);
+            left = arena->make<BinaryExpr>(left, right, op);
         }
-        root = valStack.top();
-        valStack.pop();
-        // if(debug) printToken(currentToken);
-
-        return root;
+        return left;
     }
 
-    ASTNode *ExpressionInFuncCall()
+    BinaryExpr *primaryExpression(const bool *terminators)
     {
-        if (debug)
-        {
-            cout << "expression ";
-            printToken(currentToken);
-        }
-        const vector<TokenType> operators = {
-            TokenType::OR,
-            TokenType::AND,
-            TokenType::BITWISE_OR,
-            TokenType::BITWISE_XOR,
-            TokenType::BITWISE_AND,
-            TokenType::EQUAL,
-            TokenType::NOT_EQUAL,
-            TokenType::LESS_THAN,
-            TokenType::LESS_EQUAL,
-            TokenType::GREATER_THAN,
-            TokenType::GREATER_EQUAL,
-            TokenType::LEFT_SHIFT,
-            TokenType::RIGHT_SHIFT,
-            TokenType::ADD,
-            TokenType::SUB,
-            TokenType::MUL,
-            TokenType::DIV,
-            TokenType::MOD,
-        };
-
-        const unordered_map<string, int> opPrecedence = {
-            {"||", 1},
-            {"&&", 2},
-            {"|", 3},
-            {"^", 4},
-            {"&", 5},
-            {"==", 6},
-            {"!=", 6},
-            {"<", 7},
-            {"<=", 7},
-            {">", 7},
-            {">=", 7},
-            {"<<", 8},
-            {">>", 8},
-            {"+", 9},
-            {"-", 9},
-            {"*", 10},
-            {"/", 10},
-            {"%", 10},
-            {"(", 0} // 用于处理括号;
-        };
-
-        stack<BinaryExpr *> opStack;
-        stack<BinaryExpr *> valStack;
-        BinaryExpr *root = nullptr;
-        do
-        {
-            if (debug)
-                printToken(currentToken);
-            if (find(constants.begin(), constants.end(), currentToken.type) != constants.end() || currentToken.type == TokenType::IDENTIFIER)
-            {
-                // 处理操作数
-                Token nextToken = lexer.peektoken();
-                if (currentToken.type == TokenType::IDENTIFIER)
-                {
-                    if (nextToken.type == TokenType::LPAREN)
-                    {
-                        valStack.push(new BinaryExpr(nullptr, nullptr, funcCall(nextToken)));
-                        advance();
-                        continue;
-                    }
-                    else if (nextToken.type == TokenType::LBRACKET)
-                    {
-                        // 处理数组变量
-                        string varName = currentToken.lexeme;
-                        eat(TokenType::IDENTIFIER);
-                        while (currentToken.type == TokenType::LBRACKET)
-                        {
-                            varName += "[";
-                            eat(TokenType::LBRACKET);
-                            while (currentToken.type != TokenType::RBRACKET)
-                            {
-                                varName += currentToken.lexeme;
-                                advance();
-                            }
-                            varName += "]";
-                            eat(TokenType::RBRACKET);
-                        }
-                        valStack.push(new BinaryExpr(nullptr, nullptr, varName));
-                        continue;
-                    }
-                }
-                if (currentToken.type == TokenType::CHAR_CONST)
-                {
-                    valStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme, false, true));
-                }
-                else if (currentToken.type == TokenType::STRING)
-                {
-                    valStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme, true, false));
-                }
-                else
-                    valStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme));
-                advance();
-            }
-            else if (find(operators.begin(), operators.end(), currentToken.type) != operators.end())
-            {
-                // 处理操作符
-                while (!opStack.empty() && opPrecedence.at(opStack.top()->op) >= opPrecedence.at(currentToken.lexeme))
-                {
-                    // 处理栈顶运算符
-                    auto opNode = opStack.top();
-                    opStack.pop();
-                    if (valStack.size() < 2)
-                    {
-                        throwError("insufficient values for operator " + opNode->op);
-                    }
-                    auto right = valStack.top();
-                    valStack.pop();
-                    auto left = valStack.top();
-                    valStack.pop();
-                    opNode->left = left;
-                    opNode->right = right;
-                    valStack.push(opNode);
-                }
-                // 将当前运算符入栈
-                opStack.push(new BinaryExpr(nullptr, nullptr, currentToken.lexeme));
-                advance();
-            }
-            else if (currentToken.type == TokenType::LPAREN)
+        if (hasFailed)
+            return nullptr;
+        trace.token("primary", currentToken);
+        if (currentToken.type == TokenType::LPAREN)
+        {
+            advance();
+            BinaryExpr *inner = binaryExpression(1, terminators);
+            eat(TokenType::RPAREN);
+            return inner;
+        }
+        if (!isOperandToken(currentToken.type))
+        {
+            if (terminators && !terminators[static_cast<size_t>(currentToken.type)])
+                return fail("unexpected token in expression: " + tokenTypeToString(currentToken.type));
+            return fail("invalid expression");
+        }
+        if (currentToken.type == TokenType::IDENTIFIER)
+        {
+            Token nextToken = peek();
+            if (nextToken.type == TokenType::LPAREN)
             {
-                // 处理左括号
-                opStack.push(new BinaryExpr(nullptr, nullptr, "("));
-                advance();
+                return arena->make<BinaryExpr>(nullptr, nullptr, funcCall(nextToken));
             }
-            else if (currentToken.type == TokenType::RPAREN)
+            else if (nextToken.type == TokenType::LBRACKET)
             {
-                // 处理右括号
-                while (!opStack.empty() && opStack.top()->op != "(")
+                // 处理数组变量
+                string varName = currentToken.lexeme.str();
+                eat(TokenType::IDENTIFIER);
+                while (currentToken.type == TokenType::LBRACKET && !hasFailed)
                 {
-                    auto opNode = opStack.top();
-                    opStack.pop();
-                    if (valStack.size() < 2)
+                    varName += "[";
+                    eat(TokenType::LBRACKET);
+                    while (currentToken.type != TokenType::RBRACKET && !hasFailed)
                     {
-                        throwError("insufficient values for operator " + opNode->op);
+                        if (currentToken.type == TokenType::END_OF_FILE)
+                            return fail("unexpected end of file in array subscript");
+                        varName += currentToken.lexeme;
+                        advance();
                     }
-                    auto right = valStack.top();
-                    valStack.pop();
-                    auto left = valStack.top();
-                    valStack.pop();
-                    opNode->left = left;
-                    opNode->right = right;
-                    valStack.push(opNode);
-                }
-                if (opStack.empty() || opStack.top()->op != "(")
-                {
-                    break;
+                    varName += "]";
+                    eat(TokenType::RBRACKET);
                 }
-
-                opStack.pop(); // 弹出左括号
-                advance();
-            }
-            else if (currentToken.type == TokenType::SEMI || currentToken.type == TokenType::COMMA || currentToken.type == TokenType::RBRACKET || currentToken.type == TokenType::RBRACE)
-            {
-                // 表达式结束
-                break;
+                return arena->make<BinaryExpr>(nullptr, nullptr, arena->intern(varName));
             }
-            else
-            {
-                throwError("unexpected token in expression: " + tokenTypeToString(currentToken.type));
-            }
-        } while (true);
-        while (!opStack.empty())
-        {
-            // 处理剩余的运算符
-            auto opNode = opStack.top();
-            opStack.pop();
-            if (valStack.size() < 2)
-            {
-                throwError("insufficient values for operator " + opNode->op);
-            }
-            auto right = valStack.top();
-            valStack.pop();
-            auto left = valStack.top();
-            valStack.pop();
-            opNode->left = left;
-            opNode->right = right;
-            valStack.push(opNode);
         }
-        if (valStack.size() != 1)
-        {
-            throwError("invalid expression");
-        }
-        root = valStack.top();
-        valStack.pop();
-        return root;
+        BinaryExpr *operand;
+        if (currentToken.type == TokenType::CHAR_CONST)
+            operand = arena->make<BinaryExpr>(nullptr, nullptr, symbol(currentToken), false, true);
+        else if (currentToken.type == TokenType::STRING)
+            operand = arena->make<BinaryExpr>(nullptr, nullptr, symbol(currentToken), true, false);
+        else
+            operand = arena->make<BinaryExpr>(nullptr, nullptr, symbol(currentToken));
+        advance();
+        return operand;
     }
 };
+
+typedef BasicParser<NullTrace> Parser;
+typedef BasicParser<RingTrace> DebugParser;
@@ -0,0 +1,213 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include "FileUtil.hpp"
+
+using namespace std;
+
+// 格式化输出的目标：先写入固定大小的缓冲区，满了再整块交给后端
+// 缩进直接从预先填好的制表符/空格串中切片，不产生临时 string
+class OutputSink
+{
+private:
+    static const size_t BUFFER_SIZE = 64 * 1024;
+    static const size_t INDENT_SLICE = 64;
+    vector<char> buffer;
+    size_t used = 0;
+    size_t written = 0; // 已交给后端的字节数
+    bool failed = false;
+
+    void drain(const char *data, size_t size)
+    {
+        if (size == 0 || failed)
+            return;
+        if (!sinkWrite(data, size))
+            failed = true;
+        written += size;
+    }
+
+protected:
+    // 后端：把一整块数据写到最终目标，失败返回 false
+    virtual bool sinkWrite(const char *data, size_t size) = 0;
+
+public:
+    OutputSink() : buffer(BUFFER_SIZE) {}
+    OutputSink(const OutputSink &) = delete;
+    OutputSink &operator=(const OutputSink &) = delete;
+    // 派生类析构时需自行 flush()，此处虚函数已无法分派到后端
+    virtual ~OutputSink() {}
+
+    OutputSink &write(const char *data, size_t size)
+    {
+        if (failed)
+            return *this;
+        if (size > BUFFER_SIZE - used)
+        {
+            flush();
+            // 超过缓冲区的大块数据直接写出
+            if (size >= BUFFER_SIZE)
+            {
+                drain(data, size);
+                return *this;
+            }
+        }
+        memcpy(buffer.data() + used, data, size);
+        used += size;
+        return *this;
+    }
+
+    OutputSink &put(char c)
+    {
+        if (failed)
+            return *this;
+        if (used == BUFFER_SIZE)
+            flush();
+        buffer[used++] = c;
+        return *this;
+    }
+
+    // 输出 n 个缩进字符（默认制表符）
+    OutputSink &indent(int n, char ch = '\t')
+    {
+        static const char tabs[INDENT_SLICE + 1] =
+            "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t"
+            "\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t\t";
+        static const char spaces[INDENT_SLICE + 1] =
+            "                                "
+            "                                ";
+        if (ch != '\t' && ch != ' ')
+        {
+            for (int i = 0; i < n; ++i)
+                put(ch);
+            return *this;
+        }
+        const char *slice = ch == '\t' ? tabs : spaces;
+        size_t remaining = n > 0 ? (size_t)n : 0;
+        while (remaining > 0)
+        {
+            size_t chunk = remaining < INDENT_SLICE ? remaining : INDENT_SLICE;
+            write(slice, chunk);
+            remaining -= chunk;
+        }
+        return *this;
+    }
+
+    OutputSink &operator<<(const char *s) { return write(s, strlen(s)); }
+    OutputSink &operator<<(const string &s) { return write(s.data(), s.size()); }
+    OutputSink &operator<<(char c) { return put(c); }
+
+    // 把缓冲区中的内容交给后端；后端失败后其余输出全部丢弃
+    void flush()
+    {
+        drain(buffer.data(), used);
+        used = 0;
+    }
+
+    bool good() const { return !failed; }
+    // 累计输出的字节数（含尚未 flush 的部分）
+    size_t bytesWritten() const { return written + used; }
+};
+
+// 写入 ostream（如 cout、ofstream）
+class StreamSink : public OutputSink
+{
+private:
+    ostream &out;
+
+protected:
+    bool sinkWrite(const char *data, size_t size) override
+    {
+        out.write(data, (streamsize)size);
+        return (bool)out;
+    }
+
+public:
+    explicit StreamSink(ostream &o) : out(o) {}
+    ~StreamSink() { flush(); }
+};
+
+// 直接用 write(2) 写入文件描述符，不经过 iostream
+class FdSink : public OutputSink
+{
+private:
+    int fd;
+
+protected:
+    bool sinkWrite(const char *data, size_t size) override
+    {
+        return writeAll(fd, data, size);
+    }
+
+public:
+    explicit FdSink(int f) : fd(f) {}
+    ~FdSink() { flush(); }
+};
+
+// 追加到内存中的 string
+class StringSink : public OutputSink
+{
+private:
+    string &target;
+
+protected:
+    bool sinkWrite(const char *data, size_t size) override
+    {
+        target.append(data, size);
+        return true;
+    }
+
+public:
+    explicit StringSink(string &s) : target(s) {}
+    ~StringSink() { flush(); }
+};
+
+// 不保存输出，而是逐块与期望内容比较；第一次不一致后后端报告失败，其余输出被丢弃
+class CompareSink : public OutputSink
+{
+private:
+    const char *expected;
+    size_t expectedSize;
+    size_t offset = 0;              // 已比较且一致的字节数
+    size_t mismatch = string::npos; // 第一个不一致字节的位置
+
+protected:
+    bool sinkWrite(const char *data, size_t size) override
+    {
+        size_t avail = expectedSize - offset;
+        size_t n = size < avail ? size : avail;
+        if (memcmp(data, expected + offset, n) != 0)
+        {
+            size_t i = 0;
+            while (data[i] == expected[offset + i])
+                ++i;
+            mismatch = offset + i;
+            return false;
+        }
+        offset += n;
+        if (size > avail)
+        {
+            mismatch = expectedSize; // 输出比期望内容长
+            return false;
+        }
+        return true;
+    }
+
+public:
+    CompareSink(const char *data, size_t size) : expected(data), expectedSize(size) {}
+    ~CompareSink() { flush(); }
+
+    // 输出与期望内容完全相同
+    bool matches()
+    {
+        flush();
+        return good() && offset == expectedSize;
+    }
+    // 第一个不一致字节在期望内容中的位置；输出较短时为输出的长度
+    size_t firstDifference()
+    {
+        flush();
+        return mismatch != string::npos ? mismatch : offset;
+    }
+};
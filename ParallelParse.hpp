@@ -0,0 +1,148 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include <algorithm>
+#include "SourceBuffer.hpp"
+#include "Lexer-Paser.hpp"
+#include "TopLevelScan.hpp"
+#include "WorkerPool.hpp"
+
+using namespace std;
+
+// 并行解析一个大文件：先用 scanTopLevel 找出顶层定义的边界，把相邻的定义合成若干块，
+// 每块在各自的线程上用独立的 Parser 解析到独立的 arena，最后按顺序拼接成一个 ProgramNode
+// 解析器在顶层定义之间没有状态，因此结果与顺序解析完全相同
+// 任一块解析失败（语法错误，或预扫描与解析器对边界的判断不一致）时退回顺序解析，错误信息与行号不变
+class ParallelParser
+{
+private:
+    static const size_t MIN_PARALLEL_BYTES = 1024 * 1024; // 更小的文件直接顺序解析
+    static const size_t MIN_CHUNK_BYTES = 64 * 1024;
+    static const size_t CHUNKS_PER_WORKER = 8; // 块数多于线程数，耗时不均时也能均衡
+
+    struct Chunk
+    {
+        size_t begin;
+        size_t end;
+        int line;
+        int column;
+        unique_ptr<ASTArena> arena;
+        vector<ASTNode *> items;
+        LexerCounters counters;
+        bool failed = false;
+    };
+
+    const SourceBuffer &source;
+    ASTArena &arena; // 存放 ProgramNode；顺序解析时存放全部节点
+    vector<Chunk> chunks;
+    LexerCounters counters;
+    size_t nodes = 0;
+    vector<Diagnostic> *diagnostics = nullptr;
+    bool timed = false; // 统计词法分析耗时，见 timeLexer()
+    bool hasFailed = false;
+    Diagnostic failure;
+
+    void parseChunk(Chunk &chunk)
+    {
+        chunk.arena.reset(new ASTArena());
+        SourceBuffer view(source.data() + chunk.begin, chunk.end - chunk.begin);
+        Parser parser(view, chunk.line, chunk.column, chunk.arena.get());
+        if (timed)
+            parser.timeLexer();
+        while (!parser.atEnd() && !parser.failed())
+            chunk.items.push_back(parser.topLevelItem());
+        chunk.failed = parser.failed();
+        chunk.counters = parser.lexerCounters();
+    }
+
+    ASTNode *parseSequential()
+    {
+        chunks.clear();
+        Parser parser(source, &arena);
+        if (timed)
+            parser.timeLexer();
+        parser.recoverErrors(diagnostics);
+        ASTNode *root = parser.program();
+        counters = parser.lexerCounters();
+        nodes = parser.nodeCount();
+        hasFailed = parser.failed();
+        failure = parser.error();
+        return root;
+    }
+
+public:
+    ParallelParser(const SourceBuffer &src, ASTArena &rootArena) : source(src), arena(rootArena) {}
+    ParallelParser(const ParallelParser &) = delete;
+    ParallelParser &operator=(const ParallelParser &) = delete;
+
+    // 开启错误恢复（见 Parser::recoverErrors）；此时总是顺序解析，诊断按源码顺序排列
+    void recoverErrors(vector<Diagnostic> *out) { diagnostics = out; }
+    // 统计词法分析耗时（见 Lexer::timeScans），并行解析时为各块之和
+    void timeLexer() { timed = true; }
+
+    // 解析整个文件；节点在本对象与 rootArena 存活期间有效，出错时返回 nullptr，见 failed()/error()
+    ASTNode *program(size_t workers)
+    {
+        const char *data = source.data();
+        size_t size = source.size();
+        if (workers <= 1 || size < MIN_PARALLEL_BYTES || diagnostics)
+            return parseSequential();
+
+        vector<SourceSpan> spans;
+        scanTopLevel(data, size, 0, size, spans);
+        size_t target = max((size_t)MIN_CHUNK_BYTES, size / (workers * CHUNKS_PER_WORKER)); // 转为临时值：max 按引用取参
+        // 第一块从 0 开始，之后每块从某个定义的起点开始，到下一块的起点为止
+        size_t line = 1, counted = 0;
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            size_t begin = chunks.empty() ? 0 : spans[i].begin;
+            if (!chunks.empty() && begin - chunks.back().begin < target)
+                continue;
+            if (!chunks.empty())
+                chunks.back().end = begin;
+            line += count(data + counted, data + begin, '\n');
+            counted = begin;
+            const char *lineStart = data + begin;
+            while (lineStart != data && lineStart[-1] != '\n')
+                --lineStart;
+            Chunk chunk;
+            chunk.begin = begin;
+            chunk.end = size;
+            chunk.line = (int)line;
+            chunk.column = (int)(data + begin - lineStart);
+            chunks.push_back(std::move(chunk));
+        }
+        if (chunks.size() <= 1)
+            return parseSequential();
+
+        parallelFor(chunks.size(), workers, [this](size_t i) { parseChunk(chunks[i]); });
+
+        size_t total = 0;
+        for (const auto &chunk : chunks)
+        {
+            if (chunk.failed)
+                return parseSequential();
+            total += chunk.items.size();
+        }
+        vector<ASTNode *> items;
+        items.reserve(total);
+        counters = LexerCounters();
+        nodes = 1;
+        for (const auto &chunk : chunks)
+        {
+            items.insert(items.end(), chunk.items.begin(), chunk.items.end());
+            counters += chunk.counters;
+            nodes += chunk.arena->nodeCount();
+        }
+        return arena.make<ProgramNode>(items);
+    }
+
+    bool failed() const { return hasFailed; }
+    const Diagnostic &error() const { return failure; }
+    // 各块计数之和
+    const LexerCounters &lexerCounters() const { return counters; }
+    size_t nodeCount() const { return nodes; }
+    // 实际使用的块数；为 0 表示走了顺序解析
+    size_t chunkCount() const { return chunks.size(); }
+};
@@ -0,0 +1,50 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <sys/uio.h>
+#include "ASTNodes.hpp"
+#include "OutputSink.hpp"
+#include "FileUtil.hpp"
+#include "WorkerPool.hpp"
+
+using namespace std;
+
+// 把 ProgramNode 写到 fd：顶层定义分成若干连续的组，各组在线程池上输出到各自的缓冲区，
+// 再按顺序用 writev 一次写出多块。各定义的输出只取决于它自身与起始缩进，因此结果与顺序输出相同
+// 定义较少或只有一个线程时直接经 FdSink 顺序输出。写入失败返回 false
+inline bool printProgram(const ProgramNode &program, size_t workers, int fd, size_t *bytesWritten = nullptr)
+{
+    const size_t MIN_PARALLEL_ITEMS = 256;
+    const size_t GROUPS_PER_WORKER = 8;
+    size_t items = program.extdeflists.size();
+    if (workers <= 1 || items < MIN_PARALLEL_ITEMS)
+    {
+        FdSink sink(fd);
+        program.printToFile(sink);
+        sink.flush();
+        if (bytesWritten)
+            *bytesWritten = sink.bytesWritten();
+        return sink.good();
+    }
+
+    size_t groups = min(items, workers * GROUPS_PER_WORKER);
+    vector<string> buffers(groups);
+    parallelFor(groups, workers, [&](size_t g)
+    {
+        StringSink sink(buffers[g]);
+        for (size_t i = items * g / groups; i < items * (g + 1) / groups; ++i)
+            program.printItem(sink, i, 0);
+    });
+
+    vector<iovec> chunks(groups);
+    size_t total = 0;
+    for (size_t g = 0; g < groups; ++g)
+    {
+        chunks[g].iov_base = &buffers[g][0];
+        chunks[g].iov_len = buffers[g].size();
+        total += buffers[g].size();
+    }
+    if (bytesWritten)
+        *bytesWritten = total;
+    return writevAll(fd, chunks);
+}
@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "SourceBuffer.hpp"
+#include "Lexer-Paser.hpp"
+#include "OutputSink.hpp"
+#include "TopLevelScan.hpp"
+
+using namespace std;
+
+// 范围格式化的结果：把原文的 [begin, end) 替换为 text；begin == end 且 text 为空表示无需改动
+struct RangeEdit
+{
+    size_t begin = 0;
+    size_t end = 0;
+    string text;
+};
+
+// 只格式化第 firstLine 到 lastLine 行（从 1 开始，含两端）
+// 选出覆盖这些行的最少的顶层定义；选区完全落在某个语句块内部时，改为选出该块中覆盖选区的语句
+// 只解析选区所在的顶层定义、只输出选中的节点，开销与选区大小相关，与文件大小无关
+// 语法错误时返回 false，错误信息写入 error
+inline bool formatLines(const SourceBuffer &source, int firstLine, int lastLine, ASTArena &arena, RangeEdit &edit, string &error)
+{
+    edit = RangeEdit();
+    const char *data = source.data();
+    size_t size = source.size();
+
+    // 行号换算为字节范围：[selBegin, selEnd)，selEnd 为最后一行的换行处
+    size_t selBegin = 0;
+    int line = 1;
+    while (line < firstLine && selBegin < size)
+    {
+        const char *nl = static_cast<const char *>(memchr(data + selBegin, '\n', size - selBegin));
+        if (!nl)
+            return true; // 起始行超出文件
+        selBegin = (size_t)(nl - data) + 1;
+        ++line;
+    }
+    if (line < firstLine)
+        return true;
+    size_t selEnd = selBegin;
+    while (true)
+    {
+        const char *nl = static_cast<const char *>(memchr(data + selEnd, '\n', size - selEnd));
+        selEnd = nl ? (size_t)(nl - data) : size;
+        if (!nl || line >= lastLine)
+            break;
+        ++selEnd;
+        ++line;
+    }
+
+    vector<SourceSpan> spans;
+    scanTopLevel(data, size, selBegin, selEnd, spans);
+    if (spans.empty())
+        return true;
+
+    // 只把选中的定义交给解析器
+    size_t parseBegin = spans.front().begin;
+    const char *lineStart = data + parseBegin;
+    while (lineStart != data && lineStart[-1] != '\n')
+        --lineStart;
+    int parseLine = 1 + (int)count(data, data + parseBegin, '\n');
+    SourceBuffer view(data + parseBegin, spans.back().end - parseBegin);
+    Parser parser(view, parseLine, (int)(data + parseBegin - lineStart), &arena);
+    vector<CompoundStmt *> blocks;
+    parser.recordBlocks(&blocks);
+    vector<ASTNode *> items;
+    while (!parser.atEnd() && !parser.failed())
+        items.push_back(parser.topLevelItem());
+    if (parser.failed())
+    {
+        error = parser.error().message;
+        return false;
+    }
+    if (items.empty())
+        return true;
+
+    // 选区所在的最内层语句块：'{' 在选区之前的行，'}' 在选区之后的行
+    const CompoundStmt *block = nullptr;
+    for (const CompoundStmt *b : blocks)
+    {
+        if (b->sourceBegin < data + selBegin && b->sourceEnd - 1 >= data + selEnd &&
+            (!block || b->sourceEnd - b->sourceBegin < block->sourceEnd - block->sourceBegin))
+            block = b;
+    }
+
+    const char *replaceBegin;
+    const char *replaceEnd;
+    StringSink sink(edit.text);
+    if (block)
+    {
+        size_t first = 0;
+        while (first < block->statements.size() &&
+               (!block->statements[first] || block->statements[first]->sourceEnd <= data + selBegin))
+            ++first;
+        size_t last = first;
+        while (last < block->statements.size() &&
+               (!block->statements[last] || block->statements[last]->sourceBegin < data + selEnd))
+            ++last;
+        while (last > first && !block->statements[last - 1])
+            --last;
+        if (first == last)
+            return true; // 选区只含空行或注释
+        for (size_t i = first; i < last; ++i)
+            block->printStatement(sink, i, block->childIndent);
+        replaceBegin = block->statements[first]->sourceBegin;
+        replaceEnd = block->statements[last - 1]->sourceEnd;
+    }
+    else
+    {
+        for (const ASTNode *item : items)
+            item->printToFile(sink);
+        replaceBegin = items.front()->sourceBegin;
+        replaceEnd = items.back()->sourceEnd;
+    }
+    sink.flush();
+
+    // 替换范围之前同一行只有空白时连同缩进一起替换，否则去掉输出的缩进接在原文之后
+    while (!edit.text.empty() && edit.text.back() == '\n')
+        edit.text.pop_back();
+    const char *p = replaceBegin;
+    while (p != data && (p[-1] == ' ' || p[-1] == '\t'))
+        --p;
+    if (p == data || p[-1] == '\n')
+        replaceBegin = p;
+    else
+        edit.text.erase(0, edit.text.find_first_not_of("\t "));
+    edit.begin = (size_t)(replaceBegin - data);
+    edit.end = (size_t)(replaceEnd - data);
+    return true;
+}
@@ -0,0 +1,166 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <iterator>
+#include <cstddef>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace std;
+
+// 指向源码缓冲区中一段字符的轻量引用，本身不持有数据
+class SourceRef
+{
+private:
+    const char *ptr = "";
+    size_t len = 0;
+
+public:
+    SourceRef() {}
+    SourceRef(const char *p, size_t n) : ptr(p), len(n) {}
+    const char *data() const { return ptr; }
+    size_t size() const { return len; }
+    bool empty() const { return len == 0; }
+    const char *begin() const { return ptr; }
+    const char *end() const { return ptr + len; }
+    string str() const { return string(ptr, len); }
+    bool operator==(const char *s) const { return strlen(s) == len && memcmp(ptr, s, len) == 0; }
+    bool operator==(const string &s) const { return s.size() == len && memcmp(ptr, s.data(), len) == 0; }
+    bool operator!=(const char *s) const { return !(*this == s); }
+    bool operator!=(const string &s) const { return !(*this == s); }
+};
+
+inline ostream &operator<<(ostream &out, const SourceRef &ref)
+{
+    return out.write(ref.data(), ref.size());
+}
+inline string &operator+=(string &s, const SourceRef &ref)
+{
+    return s.append(ref.data(), ref.size());
+}
+inline string operator+(string s, const SourceRef &ref)
+{
+    s += ref;
+    return s;
+}
+inline string operator+(const char *s, const SourceRef &ref)
+{
+    return string(s) + ref;
+}
+inline string operator+(const SourceRef &ref, const char *s)
+{
+    return ref.str() + s;
+}
+
+// 一段连续、只读、在解析期间地址稳定的源码
+// 普通文件通过 mmap 零拷贝映射；标准输入等无法映射的流退化为一次性读入内存
+class SourceBuffer
+{
+private:
+    const char *data_ = "";
+    size_t size_ = 0;
+    void *mapped = nullptr; // mmap 得到的区域，为空表示未映射
+    size_t mappedSize = 0;
+    string owned; // 非映射模式下持有的数据
+
+    void release()
+    {
+        if (mapped)
+        {
+            munmap(mapped, mappedSize);
+            mapped = nullptr;
+            mappedSize = 0;
+        }
+        owned.clear();
+        data_ = "";
+        size_ = 0;
+    }
+
+public:
+    SourceBuffer() {}
+    // 从流中一次性读入（用于标准输入、管道等不可映射的输入）
+    explicit SourceBuffer(istream &in) { read(in); }
+    // 引用一段外部内存，调用者保证其生命周期
+    SourceBuffer(const char *data, size_t size) : data_(data), size_(size) {}
+    SourceBuffer(const SourceBuffer &) = delete;
+    SourceBuffer &operator=(const SourceBuffer &) = delete;
+    SourceBuffer(SourceBuffer &&other) { *this = std::move(other); }
+    SourceBuffer &operator=(SourceBuffer &&other)
+    {
+        if (this != &other)
+        {
+            release();
+            bool ownsData = !other.mapped && other.data_ == other.owned.data();
+            mapped = other.mapped;
+            mappedSize = other.mappedSize;
+            owned = std::move(other.owned);
+            size_ = other.size_;
+            data_ = ownsData ? owned.data() : other.data_;
+            other.mapped = nullptr;
+            other.mappedSize = 0;
+            other.data_ = "";
+            other.size_ = 0;
+        }
+        return *this;
+    }
+    ~SourceBuffer() { release(); }
+
+    // 映射文件；失败返回 false
+    bool open(const string &path)
+    {
+        release();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0)
+        {
+            ::close(fd);
+            return false;
+        }
+        if (S_ISREG(st.st_mode) && st.st_size > 0)
+        {
+            void *p = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                madvise(p, (size_t)st.st_size, MADV_SEQUENTIAL);
+                mapped = p;
+                mappedSize = (size_t)st.st_size;
+                data_ = static_cast<const char *>(p);
+                size_ = mappedSize;
+                ::close(fd);
+                return true;
+            }
+        }
+        // 空文件或无法映射的文件（如 FIFO）：退化为读入
+        char chunk[65536];
+        ssize_t n;
+        while ((n = ::read(fd, chunk, sizeof(chunk))) > 0)
+            owned.append(chunk, (size_t)n);
+        ::close(fd);
+        if (n < 0)
+        {
+            owned.clear();
+            return false;
+        }
+        data_ = owned.data();
+        size_ = owned.size();
+        return true;
+    }
+
+    void read(istream &in)
+    {
+        release();
+        owned.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+        data_ = owned.data();
+        size_ = owned.size();
+    }
+
+    const char *data() const { return data_; }
+    size_t size() const { return size_; }
+    const char *begin() const { return data_; }
+    const char *end() const { return data_ + size_; }
+};
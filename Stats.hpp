@@ -0,0 +1,106 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include "Lexer-Paser.hpp"
+
+using namespace std;
+
+// 一次格式化的计数与分阶段耗时，由 --stats 输出
+// 计时使用单调时钟；未开启 --stats 时不会创建该对象
+// 词法分析与解析交错进行，它的耗时在解析过程中逐个 token 统计，包含在 parse 阶段内（并行解析时为各线程之和）
+class FormatStats
+{
+private:
+    typedef chrono::steady_clock Clock;
+    struct Phase
+    {
+        string name;
+        double ms;
+    };
+    vector<Phase> phases;
+    Clock::time_point phaseStart;
+    Clock::time_point createdAt;
+
+public:
+    string file;
+    size_t sourceBytes = 0;
+    LexerCounters lexer;
+    size_t nodes = 0;
+    size_t outputBytes = 0;
+
+    FormatStats() : createdAt(Clock::now()) {}
+
+    void begin() { phaseStart = Clock::now(); }
+    double lexMs() const { return chrono::duration<double, milli>(lexer.scanTime).count(); }
+    // 结束当前阶段并记录耗时，随后立即开始下一阶段
+    void end(const string &name)
+    {
+        Clock::time_point now = Clock::now();
+        phases.push_back({name, chrono::duration<double, milli>(now - phaseStart).count()});
+        phaseStart = now;
+    }
+
+    void printText(ostream &out) const
+    {
+        out << "file:          " << file << "\n";
+        out << "source bytes:  " << sourceBytes << "\n";
+        out << "tokens:        " << lexer.returned << " (scanned " << lexer.scanned << ")\n";
+        out << "peeks:         " << lexer.peeks << " (replayed " << lexer.replayed << " tokens from lookahead)\n";
+        out << "seeks:         " << lexer.seeks << " (lookahead scans; the input is never repositioned)\n";
+        out << "nodes:         " << nodes << "\n";
+        out << "output bytes:  " << outputBytes << "\n";
+        for (const auto &phase : phases)
+        {
+            char line[64];
+            snprintf(line, sizeof(line), "%-8s %10.3f ms\n", (phase.name + ":").c_str(), phase.ms);
+            out << line;
+            if (phase.name == "parse")
+            {
+                snprintf(line, sizeof(line), "  %-6s %10.3f ms (within parse)\n", "lex:", lexMs());
+                out << line;
+            }
+        }
+        char line[64];
+        snprintf(line, sizeof(line), "%-8s %10.3f ms\n", "total:",
+                 chrono::duration<double, milli>(Clock::now() - createdAt).count());
+        out << line;
+    }
+
+    void printJson(ostream &out) const
+    {
+        out << "{\"file\": \"";
+        for (char c : file)
+        {
+            if (c == '"' || c == '\\')
+                out << '\\' << c;
+            else if (c == '\n')
+                out << "\\n";
+            else if (c == '\t')
+                out << "\\t";
+            else if ((unsigned char)c < 0x20)
+            {
+                // 其余控制字符按 JSON 要求写成 \u00XX
+                char escaped[8];
+                snprintf(escaped, sizeof(escaped), "\\u%04x", (unsigned char)c);
+                out << escaped;
+            }
+            else
+                out << c;
+        }
+        out << "\", \"source_bytes\": " << sourceBytes
+            << ", \"tokens\": " << lexer.returned
+            << ", \"tokens_scanned\": " << lexer.scanned
+            << ", \"peeks\": " << lexer.peeks
+            << ", \"lookahead_replayed\": " << lexer.replayed
+            << ", \"seeks\": " << lexer.seeks
+            << ", \"nodes\": " << nodes
+            << ", \"output_bytes\": " << outputBytes
+            << ", \"phases_ms\": {";
+        for (size_t i = 0; i < phases.size(); ++i)
+            out << (i ? ", " : "") << "\"" << phases[i].name << "\": " << phases[i].ms;
+        out << "}, \"lex_ms\": " << lexMs() << ", \"total_ms\": " << chrono::duration<double, milli>(Clock::now() - createdAt).count() << "}\n";
+    }
+};
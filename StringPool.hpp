@@ -0,0 +1,190 @@
+#pragma once
+#include <iostream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include <cstring>
+#include "SourceBuffer.hpp"
+#include "OutputSink.hpp"
+
+using namespace std;
+
+// 驻留字符串的句柄：指向池中以 '\0' 结尾的内容，其前 4 字节是长度
+// 同一个池（或同为关键字表）中内容相同的字符串句柄相同，比较只需比较指针
+class Symbol
+{
+private:
+    static const char *emptyEntry()
+    {
+        static const uint32_t entry[2] = {0, 0}; // 长度 0，随后是 '\0'
+        return reinterpret_cast<const char *>(entry) + sizeof(uint32_t);
+    }
+    const char *p;
+
+public:
+    Symbol() : p(emptyEntry()) {}
+    explicit Symbol(const char *entry) : p(entry) {}
+    const char *data() const { return p; }
+    const char *c_str() const { return p; }
+    size_t size() const
+    {
+        uint32_t n;
+        memcpy(&n, p - sizeof(uint32_t), sizeof(n));
+        return n;
+    }
+    bool empty() const { return size() == 0; }
+    string str() const { return string(p, size()); }
+    bool operator==(const Symbol &other) const { return p == other.p; }
+    bool operator!=(const Symbol &other) const { return p != other.p; }
+};
+
+inline ostream &operator<<(ostream &out, const Symbol &s)
+{
+    return out.write(s.data(), (streamsize)s.size());
+}
+inline OutputSink &operator<<(OutputSink &out, const Symbol &s)
+{
+    return out.write(s.data(), s.size());
+}
+
+// 字符串驻留池：相同内容只保存一份，以 32 位句柄或 Symbol 引用
+// 句柄 0 固定表示空串。内容分块存放、从不移动，句柄与 Symbol 在 clear() 或池销毁之前有效
+class StringPool
+{
+private:
+    enum : uint32_t { EMPTY = 0xFFFFFFFFu };
+    static const size_t BLOCK_SIZE = 16 * 1024;
+    vector<unique_ptr<char[]>> blocks;
+    vector<unique_ptr<char[]>> large;
+    size_t largeBytes = 0;
+    size_t blockIndex = 0;        // 正在使用的块
+    size_t used = 0;              // 当前块已用字节数
+    vector<const char *> entries; // 句柄 -> 内容
+    vector<uint32_t> slots;       // 开放寻址散列表，存放句柄；大小为 2 的幂
+
+    static uint32_t hashOf(const char *s, size_t n)
+    {
+        uint32_t h = 2166136261u; // FNV-1a
+        for (size_t i = 0; i < n; ++i)
+            h = (h ^ (unsigned char)s[i]) * 16777619u;
+        return h;
+    }
+
+    // 存放 [长度][内容]['\0']，返回内容的起点
+    const char *store(const char *s, size_t n)
+    {
+        size_t need = sizeof(uint32_t) + n + 1;
+        need = (need + sizeof(uint32_t) - 1) & ~(sizeof(uint32_t) - 1);
+        if (need > BLOCK_SIZE)
+        {
+            // 超长字符串单独申请，不占用块
+            large.emplace_back(new char[need]);
+            largeBytes += need;
+            return fill(large.back().get(), s, n);
+        }
+        if (need > BLOCK_SIZE - used)
+        {
+            if (++blockIndex == blocks.size())
+                blocks.emplace_back(new char[BLOCK_SIZE]);
+            used = 0;
+        }
+        const char *entry = fill(blocks[blockIndex].get() + used, s, n);
+        used += need;
+        return entry;
+    }
+
+    static const char *fill(char *at, const char *s, size_t n)
+    {
+        uint32_t len = (uint32_t)n;
+        memcpy(at, &len, sizeof(len));
+        memcpy(at + sizeof(len), s, n);
+        at[sizeof(len) + n] = '\0';
+        return at + sizeof(len);
+    }
+
+    bool equals(uint32_t handle, const char *s, size_t n) const
+    {
+        Symbol sym(entries[handle]);
+        return sym.size() == n && memcmp(sym.data(), s, n) == 0;
+    }
+
+    void grow()
+    {
+        vector<uint32_t> old;
+        old.swap(slots);
+        slots.assign(old.size() * 2, EMPTY);
+        size_t mask = slots.size() - 1;
+        for (uint32_t handle : old)
+        {
+            if (handle == EMPTY)
+                continue;
+            Symbol sym(entries[handle]);
+            size_t i = hashOf(sym.data(), sym.size()) & mask;
+            while (slots[i] != EMPTY)
+                i = (i + 1) & mask;
+            slots[i] = handle;
+        }
+    }
+
+public:
+    StringPool() { clear(); }
+    StringPool(const StringPool &) = delete;
+    StringPool &operator=(const StringPool &) = delete;
+    StringPool(StringPool &&) = default;
+    StringPool &operator=(StringPool &&) = default;
+
+    // 丢弃所有字符串，保留已申请的块
+    void clear()
+    {
+        entries.assign(1, Symbol().data());
+        slots.assign(64, EMPTY);
+        if (blocks.empty())
+            blocks.emplace_back(new char[BLOCK_SIZE]);
+        blockIndex = 0;
+        used = 0;
+        large.clear();
+        largeBytes = 0;
+    }
+
+    uint32_t intern(const char *s, size_t n)
+    {
+        if (n == 0)
+            return 0;
+        size_t mask = slots.size() - 1;
+        size_t i = hashOf(s, n) & mask;
+        while (slots[i] != EMPTY)
+        {
+            if (equals(slots[i], s, n))
+                return slots[i];
+            i = (i + 1) & mask;
+        }
+        uint32_t handle = (uint32_t)entries.size();
+        entries.push_back(store(s, n));
+        slots[i] = handle;
+        if (entries.size() * 2 > slots.size())
+            grow();
+        return handle;
+    }
+    uint32_t intern(const string &s) { return intern(s.data(), s.size()); }
+    uint32_t intern(const SourceRef &s) { return intern(s.data(), s.size()); }
+    uint32_t intern(const Symbol &s) { return intern(s.data(), s.size()); }
+
+    Symbol symbol(uint32_t handle) const { return Symbol(entries[handle]); }
+    Symbol symbol(const char *s, size_t n) { return symbol(intern(s, n)); }
+    Symbol symbol(const string &s) { return symbol(intern(s)); }
+    Symbol symbol(const SourceRef &s) { return symbol(intern(s)); }
+
+    SourceRef view(uint32_t handle) const
+    {
+        Symbol sym(entries[handle]);
+        return SourceRef(sym.data(), sym.size());
+    }
+    // 已驻留的字符串数（含空串）
+    size_t size() const { return entries.size(); }
+    // 占用的内存字节数
+    size_t bytes() const
+    {
+        return blocks.size() * BLOCK_SIZE + largeBytes + entries.capacity() * sizeof(const char *) + slots.capacity() * sizeof(uint32_t);
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+#include <vector>
+#include <cstddef>
+
+using namespace std;
+
+// 顶层定义在源码中的范围 [begin, end)，begin 是第一个非空白、非注释字节
+struct SourceSpan
+{
+    size_t begin;
+    size_t end;
+};
+
+// 不经词法分析、逐字节找出顶层定义的边界，只跳过注释、字符串与字符常量并统计花括号深度：
+//   深度 0 的预处理行到不以 '\' 续行的换行为止
+//   深度 0 的 ';' 结束一个定义
+//   紧跟 ')' 的 '{' 是函数体，与之匹配的 '}' 结束该定义；其余 '{' 属于初始化列表或结构体
+// 把与 [selBegin, selEnd) 相交的定义追加到 spans；扫描在第一个起点不小于 selEnd 的定义处停止
+inline void scanTopLevel(const char *data, size_t size, size_t selBegin, size_t selEnd, vector<SourceSpan> &spans)
+{
+    const size_t NONE = (size_t)-1;
+    size_t begin = NONE;
+    int depth = 0;
+    bool functionBody = false;
+    char last = 0; // 深度 0 处上一个有效字符
+    size_t i = 0;
+    auto finish = [&](size_t end) {
+        if (end > selBegin && begin < selEnd)
+            spans.push_back({begin, end});
+        begin = NONE;
+        functionBody = false;
+        last = 0;
+    };
+    while (i < size)
+    {
+        char c = data[i];
+        if (c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f' || c == '\v')
+        {
+            ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < size && data[i + 1] == '/')
+        {
+            while (i < size && data[i] != '\n')
+                ++i;
+            continue;
+        }
+        if (c == '/' && i + 1 < size && data[i + 1] == '*')
+        {
+            i += 2;
+            while (i + 1 < size && !(data[i] == '*' && data[i + 1] == '/'))
+                ++i;
+            i = i + 1 < size ? i + 2 : size;
+            continue;
+        }
+        if (begin == NONE)
+        {
+            if (i >= selEnd)
+                return;
+            begin = i;
+            if (c == '#')
+            {
+                while (i < size && !(data[i] == '\n' && data[i - 1] != '\\'))
+                    ++i;
+                finish(i);
+                continue;
+            }
+        }
+        if (c == '"' || c == '\'')
+        {
+            // 与词法分析器一致：字符串到下一个 '"' 为止，不处理转义；字符常量处理转义
+            ++i;
+            while (i < size && data[i] != c)
+                i += c == '\'' && data[i] == '\\' ? 2 : 1;
+            ++i;
+            if (depth == 0)
+                last = c;
+            continue;
+        }
+        ++i;
+        if (c == '{')
+        {
+            if (depth == 0)
+                functionBody = last == ')';
+            ++depth;
+        }
+        else if (c == '}')
+        {
+            if (depth > 0 && --depth == 0 && functionBody)
+                finish(i);
+        }
+        else if (depth == 0 && c == ';')
+            finish(i);
+        else if (depth == 0)
+            last = c;
+    }
+    if (begin != NONE)
+        finish(size);
+}
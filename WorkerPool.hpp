@@ -0,0 +1,40 @@
+#pragma once
+#include <atomic>
+#include <functional>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// 默认的工作线程数：CPU 核数，至少为 1
+inline size_t defaultWorkerCount()
+{
+    unsigned n = thread::hardware_concurrency();
+    return n == 0 ? 1 : n;
+}
+
+// 用 workers 个线程执行 task(0) ... task(count - 1)，全部完成后返回
+// 各线程从共享计数器领取下标，因此耗时不均的任务也能均衡分配
+inline void parallelFor(size_t count, size_t workers, const function<void(size_t)> &task)
+{
+    if (workers > count)
+        workers = count;
+    if (workers <= 1)
+    {
+        for (size_t i = 0; i < count; ++i)
+            task(i);
+        return;
+    }
+    atomic<size_t> nextIndex(0);
+    auto worker = [&]()
+    {
+        for (size_t i = nextIndex++; i < count; i = nextIndex++)
+            task(i);
+    };
+    vector<thread> threads;
+    for (size_t t = 1; t < workers; ++t)
+        threads.emplace_back(worker);
+    worker();
+    for (auto &th : threads)
+        th.join();
+}
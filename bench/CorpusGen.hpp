@@ -0,0 +1,278 @@
+#pragma once
+#include <string>
+#include <random>
+#include <cstdint>
+
+using namespace std;
+
+// 按语法模板生成 Parser 能接受的合成 C 源码，用于基准测试
+// 同样的 seed 与大小总是生成同样的语料，便于不同版本之间对比
+class CorpusGenerator
+{
+private:
+    mt19937 rng;
+    string out;
+    int funcCount = 0;
+
+    int pick(int n) { return (int)(rng() % (uint32_t)n); }
+
+    void indent(int depth) { out.append(depth, '\t'); }
+
+    string var() { return string(1, (char)('a' + pick(6))); }
+
+    void operand()
+    {
+        switch (pick(6))
+        {
+        case 0:
+            out += to_string(pick(1000));
+            break;
+        case 1:
+            out += "f" + to_string(pick(funcCount > 0 ? funcCount : 1)) + "(" + var() + ", " + to_string(pick(10)) + ")";
+            break;
+        case 2:
+            out += "arr[" + var() + "]";
+            break;
+        default:
+            out += var();
+            break;
+        }
+    }
+
+    void expression(int depth)
+    {
+        static const char *ops[] = {" + ", " - ", " * ", " / ", " % ", " < ", " == ", " && ", " || "};
+        if (depth <= 0 || pick(3) == 0)
+        {
+            operand();
+            return;
+        }
+        bool paren = pick(4) == 0;
+        if (paren)
+            out += "(";
+        expression(depth - 1);
+        out += ops[pick(9)];
+        expression(depth - 1);
+        if (paren)
+            out += ")";
+    }
+
+    void localDecl(int depth)
+    {
+        static const char *types[] = {"int", "long", "unsigned int", "char", "float", "double"};
+        indent(depth);
+        out += types[pick(6)];
+        out += " ";
+        out += var();
+        if (pick(2))
+        {
+            out += " = ";
+            expression(2);
+        }
+        out += ";\n";
+    }
+
+    void assignment(int depth)
+    {
+        static const char *ops[] = {" = ", " += ", " -= "};
+        indent(depth);
+        out += var();
+        out += ops[pick(3)];
+        expression(3);
+        out += ";\n";
+    }
+
+    void call(int depth)
+    {
+        indent(depth);
+        out += "printf(\"value %d\\n\", ";
+        expression(2);
+        out += ");\n";
+    }
+
+    void block(int depth, int nesting, int count)
+    {
+        for (int i = 0; i < count; ++i)
+            statement(depth, nesting);
+    }
+
+    // 深层的 if / else if / else 链
+    void ifChain(int depth, int nesting)
+    {
+        int branches = 1 + pick(8);
+        indent(depth);
+        out += "if (";
+        expression(2);
+        out += ")\n";
+        braced(depth, nesting);
+        for (int i = 0; i < branches; ++i)
+        {
+            indent(depth);
+            out += "else if (";
+            expression(2);
+            out += ")\n";
+            braced(depth, nesting);
+        }
+        if (pick(2))
+        {
+            indent(depth);
+            out += "else\n";
+            braced(depth, nesting);
+        }
+    }
+
+    // 分支很多的 switch
+    void switchStmt(int depth, int nesting)
+    {
+        indent(depth);
+        out += "switch (" + var() + ")\n";
+        indent(depth);
+        out += "{\n";
+        int cases = 4 + pick(28);
+        for (int i = 0; i < cases; ++i)
+        {
+            indent(depth);
+            out += "case " + to_string(i) + ":\n";
+            block(depth + 1, nesting - 1, 1 + pick(2));
+            indent(depth + 1);
+            out += "break;\n";
+        }
+        indent(depth);
+        out += "default:\n";
+        indent(depth + 1);
+        out += "break;\n";
+        indent(depth);
+        out += "}\n";
+    }
+
+    void braced(int depth, int nesting)
+    {
+        indent(depth);
+        out += "{\n";
+        block(depth + 1, nesting - 1, 1 + pick(4));
+        indent(depth);
+        out += "}\n";
+    }
+
+    void loop(int depth, int nesting)
+    {
+        switch (pick(3))
+        {
+        case 0:
+            indent(depth);
+            out += "while (";
+            expression(2);
+            out += ")\n";
+            braced(depth, nesting);
+            break;
+        case 1:
+            indent(depth);
+            out += "do\n";
+            braced(depth, nesting);
+            indent(depth);
+            out += "while (";
+            expression(2);
+            out += ");\n";
+            break;
+        default:
+            indent(depth);
+            out += "for (int i = 0; i < " + to_string(pick(100)) + "; i + 1)\n";
+            braced(depth, nesting);
+            break;
+        }
+    }
+
+    void statement(int depth, int nesting)
+    {
+        int kind = nesting > 0 ? pick(10) : pick(4);
+        switch (kind)
+        {
+        case 0:
+            localDecl(depth);
+            break;
+        case 1:
+        case 2:
+            assignment(depth);
+            break;
+        case 3:
+            call(depth);
+            break;
+        case 4:
+        case 5:
+            ifChain(depth, nesting);
+            break;
+        case 6:
+            switchStmt(depth, nesting);
+            break;
+        case 7:
+        case 8:
+            loop(depth, nesting);
+            break;
+        default:
+            braced(depth, nesting);
+            break;
+        }
+    }
+
+    // 嵌套的大初始化列表，覆盖 arrInitList
+    void initList(int dims, int width)
+    {
+        out += "{";
+        for (int i = 0; i < width; ++i)
+        {
+            if (i > 0)
+                out += ", ";
+            if (dims > 1)
+                initList(dims - 1, width);
+            else
+                out += to_string(pick(1000));
+        }
+        out += "}";
+    }
+
+    void externalArray()
+    {
+        int dims = 1 + pick(3);
+        int width = dims == 1 ? 16 + pick(240) : 2 + pick(8);
+        out += "int table" + to_string(funcCount) + "_" + to_string(pick(1000));
+        for (int d = 0; d < dims; ++d)
+            out += "[" + to_string(width) + "]";
+        out += " = ";
+        initList(dims, width);
+        out += ";\n";
+    }
+
+    void function()
+    {
+        int id = funcCount++;
+        out += "int f" + to_string(id) + "(int a, int b)\n{\n";
+        for (int i = 0; i < 3; ++i)
+            localDecl(1);
+        block(1, 3, 4 + pick(8));
+        out += "\treturn ";
+        expression(2);
+        out += ";\n}\n\n";
+    }
+
+public:
+    explicit CorpusGenerator(uint32_t seed = 1) : rng(seed) {}
+
+    // 生成约 targetBytes 字节的源码
+    string generate(size_t targetBytes)
+    {
+        out.clear();
+        funcCount = 0;
+        out += "#include <stdio.h>\n#define LIMIT 100\n\n";
+        out += "typedef int counter;\n";
+        out += "int arr[64];\n";
+        out += "int a, b, c, d, e, f;\n\n";
+        while (out.size() < targetBytes)
+        {
+            if (pick(4) == 0)
+                externalArray();
+            out += "int f" + to_string(funcCount) + "(int a, int b);\n";
+            function();
+        }
+        return out;
+    }
+};
@@ -0,0 +1,259 @@
+// 格式化流水线基准：分别测量 Lexer::gettoken、Parser::program（顺序与并行）与 ProgramNode::printToFile 的吞吐量
+// 用法：format_bench [--size MB] [--seed N] [--repeat N] [--emit out.c] [source_file.c]
+// 不给源文件时按语法模板生成合成语料
+#include <iostream>
+#include <string>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include "../SourceBuffer.hpp"
+#include "../Lexer-Paser.hpp"
+#include "../OutputSink.hpp"
+#include "../Formatter.hpp"
+#include "../Incremental.hpp"
+#include "../ParallelParse.hpp"
+#include "../FlatAST.hpp"
+#include "CorpusGen.hpp"
+
+using namespace std;
+
+static double seconds(chrono::steady_clock::time_point t0, chrono::steady_clock::time_point t1)
+{
+    return chrono::duration<double>(t1 - t0).count();
+}
+
+static void report(const char *phase, double secs, size_t bytes, size_t items, const char *itemName)
+{
+    cout << "  " << phase << ": " << secs * 1000 << " ms, "
+         << bytes / secs / (1024 * 1024) << " MB/s, "
+         << items / secs << " " << itemName << "/s\n";
+}
+
+// 增量格式化：在文件各处把一个数字改成另一个数字，测量重新解析并输出整个文件的耗时
+// 每次编辑后的结果都与完整格式化比较，确保复用是精确的
+static bool benchIncremental(const SourceBuffer &source)
+{
+    const int EDITS = 16;
+    IncrementalDocument doc;
+    if (!doc.reset(source.data(), source.size()))
+    {
+        cerr << "incremental: " << doc.error() << endl;
+        return false;
+    }
+    string text(source.data(), source.size()), output, expected;
+    double total = 0, worst = 0;
+    size_t reparsed = 0;
+    int edits = 0;
+    for (int e = 0; e < EDITS; ++e)
+    {
+        size_t pos = text.size() / EDITS * e + text.size() / (2 * EDITS);
+        while (pos < text.size() && !isdigit((unsigned char)text[pos]))
+            ++pos;
+        if (pos >= text.size())
+            continue;
+        char digit = text[pos] == '9' ? '1' : (char)(text[pos] + 1);
+        text[pos] = digit;
+        output.clear();
+        auto t0 = chrono::steady_clock::now();
+        bool parsed = doc.applyEdit(pos, 1, &digit, 1);
+        {
+            StringSink sink(output);
+            doc.print(sink);
+        }
+        auto t1 = chrono::steady_clock::now();
+        double secs = seconds(t0, t1);
+        total += secs;
+        worst = max(worst, secs);
+        reparsed += doc.reparsedItems();
+        edits++;
+
+        expected.clear();
+        ASTArena arena;
+        string error;
+        if (!parsed || !formatToString(SourceBuffer(text.data(), text.size()), arena, expected, error))
+        {
+            cerr << "incremental: " << (parsed ? error : doc.error()) << endl;
+            return false;
+        }
+        if (output != expected)
+        {
+            cerr << "incremental: output differs from a full format after edit at byte " << pos << endl;
+            return false;
+        }
+    }
+    if (edits > 0)
+        cout << "  incremental : " << edits << " one-byte edits, " << total / edits * 1000 << " ms avg, "
+             << worst * 1000 << " ms worst, " << (double)reparsed / edits << " of "
+             << doc.itemCount() << " top-level items re-parsed per edit\n";
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    double sizeMB = 4;
+    unsigned seed = 1;
+    int repeat = 5;
+    string emit, filename;
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "--size" && i + 1 < argc)
+            sizeMB = atof(argv[++i]);
+        else if (arg == "--seed" && i + 1 < argc)
+            seed = (unsigned)atoi(argv[++i]);
+        else if (arg == "--repeat" && i + 1 < argc)
+            repeat = atoi(argv[++i]);
+        else if (arg == "--emit" && i + 1 < argc)
+            emit = argv[++i];
+        else if (arg[0] != '-')
+            filename = arg;
+        else
+        {
+            cerr << "Usage: " << argv[0] << " [--size MB] [--seed N] [--repeat N] [--emit out.c] [source_file.c]" << endl;
+            return 1;
+        }
+    }
+    if (repeat < 1)
+        repeat = 1;
+
+    string generated;
+    SourceBuffer source;
+    if (!filename.empty())
+    {
+        if (!source.open(filename))
+        {
+            cerr << "Error: Could not open file " << filename << endl;
+            return 1;
+        }
+    }
+    else
+    {
+        generated = CorpusGenerator(seed).generate((size_t)(sizeMB * 1024 * 1024));
+        source = SourceBuffer(generated.data(), generated.size());
+        filename = "<generated seed " + to_string(seed) + ">";
+    }
+    if (!emit.empty())
+    {
+        ofstream out(emit, ios::binary);
+        out.write(source.data(), (streamsize)source.size());
+    }
+
+    // 每个阶段重复 repeat 次，取最快的一次，减少噪声
+    double lexBest = 1e30, parseBest = 1e30, printBest = 1e30, parallelBest = 1e30;
+    double flatParseBest = 1e30, flatPrintBest = 1e30, itemParseBest = 1e30;
+    FlatAST flat;
+    size_t workers = defaultWorkerCount();
+    size_t tokens = 0, nodes = 0, outputBytes = 0;
+    ASTArena arena;
+    string output;
+    for (int r = 0; r < repeat; ++r)
+    {
+        auto t0 = chrono::steady_clock::now();
+        Lexer lexer(source);
+        size_t count = 0;
+        while (lexer.gettoken().type != TokenType::END_OF_FILE)
+            count++;
+        auto t1 = chrono::steady_clock::now();
+        lexBest = min(lexBest, seconds(t0, t1));
+        tokens = count;
+
+        arena.reset();
+        t0 = chrono::steady_clock::now();
+        Parser parser(source, &arena);
+        ASTNode *root = parser.program();
+        t1 = chrono::steady_clock::now();
+        if (parser.failed())
+        {
+            cerr << filename << ": " << parser.error().message << endl;
+            return 1;
+        }
+        parseBest = min(parseBest, seconds(t0, t1));
+        nodes = arena.nodeCount();
+
+        output.clear();
+        t0 = chrono::steady_clock::now();
+        {
+            StringSink sink(output);
+            if (root)
+                root->printToFile(sink);
+        }
+        t1 = chrono::steady_clock::now();
+        printBest = min(printBest, seconds(t0, t1));
+        outputBytes = output.size();
+
+        // 按顶层定义切块的并行解析，结果须与顺序解析一致
+        ASTArena rootArena;
+        t0 = chrono::steady_clock::now();
+        {
+            ParallelParser parallel(source, rootArena);
+            ASTNode *parallelRoot = parallel.program(workers);
+            t1 = chrono::steady_clock::now();
+            string parallelOutput;
+            StringSink sink(parallelOutput);
+            if (parallelRoot)
+                parallelRoot->printToFile(sink);
+            sink.flush();
+            if (parallelOutput != output)
+            {
+                cerr << filename << ": parallel parse differs from sequential parse" << endl;
+                return 1;
+            }
+        }
+        parallelBest = min(parallelBest, seconds(t0, t1));
+
+        // 与 parseFlat 相同地逐个顶层定义解析并复位 arena，但不转换：与 flat parse 之差即转换为紧凑 AST 的开销
+        t0 = chrono::steady_clock::now();
+        {
+            ASTArena scratch;
+            Parser itemParser(source, &scratch);
+            while (!itemParser.atEnd() && !itemParser.failed())
+            {
+                itemParser.topLevelItem();
+                scratch.reset();
+            }
+        }
+        t1 = chrono::steady_clock::now();
+        itemParseBest = min(itemParseBest, seconds(t0, t1));
+
+        // 紧凑 AST：解析时逐个顶层定义转换，输出用 switch 遍历
+        t0 = chrono::steady_clock::now();
+        string error;
+        bool flatParsed = parseFlat(source, flat, error);
+        t1 = chrono::steady_clock::now();
+        if (!flatParsed)
+        {
+            cerr << filename << ": " << error << endl;
+            return 1;
+        }
+        flatParseBest = min(flatParseBest, seconds(t0, t1));
+        string flatOutput;
+        t0 = chrono::steady_clock::now();
+        {
+            StringSink sink(flatOutput);
+            flat.print(sink);
+        }
+        t1 = chrono::steady_clock::now();
+        flatPrintBest = min(flatPrintBest, seconds(t0, t1));
+        if (flatOutput != output)
+        {
+            cerr << filename << ": flat AST output differs from printToFile" << endl;
+            return 1;
+        }
+    }
+
+    cout << filename << ": " << source.size() << " bytes, " << tokens << " tokens, "
+         << nodes << " nodes, best of " << repeat << "\n";
+    report("gettoken    ", lexBest, source.size(), tokens, "tokens");
+    report("program     ", parseBest, source.size(), nodes, "nodes");
+    report("printToFile ", printBest, outputBytes, nodes, "nodes");
+    cout << "  (parallel program with " << workers << " workers)\n";
+    report("parallel    ", parallelBest, source.size(), nodes, "nodes");
+    cout << "  (flat AST: " << flat.nodeCount() << " nodes, " << flat.bytes() << " bytes, "
+         << (double)flat.bytes() / flat.nodeCount() << " bytes/node)\n";
+    report("item parse  ", itemParseBest, source.size(), flat.nodeCount(), "nodes");
+    report("flat parse  ", flatParseBest, source.size(), flat.nodeCount(), "nodes");
+    cout << "  (lowering to the flat AST: " << (flatParseBest - itemParseBest) * 1000 << " ms, "
+         << (flatParseBest - itemParseBest) / flatParseBest * 100 << "% of flat parse)\n";
+    report("flat print  ", flatPrintBest, outputBytes, flat.nodeCount(), "nodes");
+    return benchIncremental(source) ? 0 : 1;
+}
@@ -0,0 +1,90 @@
+// 关键字识别微基准：比较 keywordMap 查表（先构造 string）与 keywordType 直接分派
+// 用法：keyword_bench [source_file.c] [repeat]
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdlib>
+#include "../SourceBuffer.hpp"
+#include "../Lexer-Paser.hpp"
+
+using namespace std;
+
+int main(int argc, char *argv[])
+{
+    string filename = argc > 1 ? argv[1] : "test/statements.c";
+    int repeat = argc > 2 ? atoi(argv[2]) : 20000;
+    SourceBuffer source;
+    if (!source.open(filename))
+    {
+        cerr << "Error: Could not open file " << filename << endl;
+        return 1;
+    }
+
+    // 两种方法必须对所有关键字给出相同结果
+    for (const auto &entry : keywordMap)
+    {
+        if (keywordType(entry.first.data(), entry.first.size()) != entry.second)
+        {
+            cerr << "Error: keywordType mismatch for '" << entry.first << "'" << endl;
+            return 1;
+        }
+    }
+
+    // 取出源文件中所有标识符形状的片段
+    vector<SourceRef> words;
+    const char *p = source.begin(), *end = source.end();
+    while (p != end)
+    {
+        if (isalpha((unsigned char)*p) || *p == '_')
+        {
+            const char *start = p;
+            while (p != end && (isalnum((unsigned char)*p) || *p == '_'))
+                ++p;
+            words.push_back(SourceRef(start, p - start));
+        }
+        else
+            ++p;
+    }
+    if (words.empty())
+    {
+        cerr << "Error: no identifiers in " << filename << endl;
+        return 1;
+    }
+
+    size_t mapHits = 0, switchHits = 0;
+    auto t0 = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r)
+    {
+        for (const auto &w : words)
+        {
+            auto it = keywordMap.find(w.str());
+            if (it != keywordMap.end())
+                mapHits++;
+        }
+    }
+    auto t1 = chrono::steady_clock::now();
+    for (int r = 0; r < repeat; ++r)
+    {
+        for (const auto &w : words)
+        {
+            if (keywordType(w.data(), w.size()) != TokenType::IDENTIFIER)
+                switchHits++;
+        }
+    }
+    auto t2 = chrono::steady_clock::now();
+
+    if (mapHits != switchHits)
+    {
+        cerr << "Error: keyword counts differ (" << mapHits << " vs " << switchHits << ")" << endl;
+        return 1;
+    }
+    double lookups = (double)words.size() * repeat;
+    double mapNs = chrono::duration<double, nano>(t1 - t0).count() / lookups;
+    double switchNs = chrono::duration<double, nano>(t2 - t1).count() / lookups;
+    cout << filename << ": " << words.size() << " identifiers x " << repeat << " rounds\n";
+    cout << "  keywordMap.find(string): " << mapNs << " ns/identifier\n";
+    cout << "  keywordType(range):      " << switchNs << " ns/identifier\n";
+    cout << "  speedup:                 " << mapNs / switchNs << "x\n";
+    return 0;
+}
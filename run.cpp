@@ -1,124 +1,639 @@
 #include <iostream>
 #include <string>
-#include <fstream>
 #include <cctype>
 #include <vector>
 #include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include "SourceBuffer.hpp"
 #include "Lexer-Paser.hpp"
+#include "FileUtil.hpp"
+#include "WorkerPool.hpp"
+#include "OutputSink.hpp"
+#include "Stats.hpp"
+#include "Formatter.hpp"
+#include "FormatServer.hpp"
+#include "FormatCache.hpp"
+#include "RangeFormat.hpp"
+#include "ParallelParse.hpp"
+#include "ParallelPrint.hpp"
+#include "FlatAST.hpp"
 
 using namespace std;
 
-int main(int argc, char *argv[])
+// 读取输入：普通文件走 mmap，"-" 表示从标准输入读入
+static bool loadSource(const string &filename, SourceBuffer &source)
 {
-    bool debug = false;
-    string outfilename;
-    if (argc < 2)
+    if (filename == "-")
     {
-        cerr << "Error: No input file specified." << endl;
-        cerr << "Usage: " << argv[0] << " <source_file.c>" << "-argument" << endl;
-        return 1;
+        source.read(cin);
+        return true;
+    }
+    return source.open(filename);
+}
+
+// 影响输出的选项，作为缓存键的一部分；目前格式化没有可调选项
+static const char *const FORMAT_OPTIONS = "";
+
+struct FileResult
+{
+    bool ok = true;
+    bool changed = false;
+    string message;
+};
+
+// 格式化单个文件并原子地写回；每个调用拥有独立的 Lexer/Parser，可在任意线程中运行
+// 给出 cache 时先查缓存，命中则完全跳过词法与语法分析
+static FileResult formatFileInPlace(const string &path, const FormatCache *cache)
+{
+    FileResult result;
+    SourceBuffer source;
+    if (!source.open(path))
+    {
+        result.ok = false;
+        result.message = "Error: Could not open file " + path;
+        return result;
     }
-    else if (argc > 4)
+    string output;
+    FormatCache::Lookup hit = cache ? cache->lookup(source, output) : FormatCache::Lookup::Miss;
+    if (hit == FormatCache::Lookup::Unchanged)
+        return result;
+    if (hit == FormatCache::Lookup::Miss)
     {
-        cerr << "Error: Too many arguments." << endl;
-        cerr << "Usage: " << argv[0] << " <source_file.c>" << "debug" << endl;
-        return 1;
+        ASTArena arena;
+        string error;
+        if (!formatToString(source, arena, output, error))
+        {
+            result.ok = false;
+            result.message = path + ": " + error;
+            return result;
+        }
+        if (cache)
+            cache->store(source, output);
+    }
+    if (output.size() == source.size() && memcmp(output.data(), source.data(), output.size()) == 0)
+        return result;
+    result.changed = true;
+    if (!writeFileAtomic(path, output))
+    {
+        result.ok = false;
+        result.message = "Error: Could not write file " + path;
+    }
+    return result;
+}
+
+// 检查单个文件是否已是格式化结果，不写任何文件；未格式化时 changed 为 true
+static FileResult checkFile(const string &path, const FormatCache *cache)
+{
+    FileResult result;
+    SourceBuffer source;
+    if (!source.open(path))
+    {
+        result.ok = false;
+        result.message = "Error: Could not open file " + path;
+        return result;
+    }
+    string cached;
+    FormatCache::Lookup hit = cache ? cache->lookup(source, cached) : FormatCache::Lookup::Miss;
+    if (hit == FormatCache::Lookup::Unchanged)
+        return result;
+    size_t diff = 0; // 第一处不一致在原文中的位置
+    if (hit == FormatCache::Lookup::Formatted)
+    {
+        CompareSink sink(source.data(), source.size());
+        sink.write(cached.data(), cached.size());
+        diff = sink.firstDifference();
+    }
+    else
+    {
+        ASTArena arena;
+        string error;
+        if (isFormatted(source, arena, error, &diff))
+        {
+            if (cache)
+                cache->markFormatted(source);
+            return result;
+        }
+        if (!error.empty())
+        {
+            result.ok = false;
+            result.message = path + ": " + error;
+            return result;
+        }
     }
-    else if (argc == 3)
+    result.changed = true;
+    int line = 1 + (int)count(source.data(), source.data() + diff, '\n');
+    result.message = path + ":" + to_string(line) + ": not formatted";
+    return result;
+}
+
+// -i 模式：-i [-j N] [--cache-dir DIR] <file|dir|->...，"-" 表示从标准输入逐行读取文件列表
+// --check 模式参数相同，只报告未格式化的文件，不修改任何文件
+static int formatMany(int argc, char *argv[], bool check)
+{
+    size_t workers = defaultWorkerCount();
+    string cacheDir;
+    vector<string> files;
+    for (int i = 2; i < argc; ++i)
     {
-        string Flag = argv[2];
-        if (Flag == "-debug")
+        string arg = argv[i];
+        if (arg == "-j")
         {
-            debug = true;
-            const char *infilename = argv[1];
-            ifstream infile(infilename);
-            if (!infile.is_open())
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
             {
-                cerr << "Error: Could not open file " << infilename << endl;
+                cerr << "Error: -j expects a positive number of workers." << endl;
                 return 1;
             }
-            try
-            {
-                Parser parser(infile, debug);
-                ASTNode *root = parser.program();
-                if (root)
-                {
-                    root->print();
-                }
-                cout << "Finished printing AST." << endl;
-            }
-            catch (const std::runtime_error &e)
+            workers = (size_t)atoi(argv[++i]);
+        }
+        else if (arg == "--cache-dir")
+        {
+            if (i + 1 >= argc)
             {
-                cerr << e.what() << endl;
+                cerr << "Error: Cache directory not specified." << endl;
                 return 1;
             }
-
-            return 0;
+            cacheDir = argv[++i];
         }
-        else if (Flag == "-o")
+        else if (arg == "-")
         {
-            cerr << "Error: Output file not specified." << endl;
-            cerr << "Usage: " << argv[0] << " <source_file.c> -o <output_file.c>" << endl;
-            return 1;
+            string line;
+            while (getline(cin, line))
+            {
+                if (!line.empty())
+                    files.push_back(line);
+            }
         }
+        else if (isDirectory(arg))
+            collectSourceFiles(arg, files);
         else
+            files.push_back(arg);
+    }
+    if (files.empty())
+    {
+        cerr << "Error: No input file specified." << endl;
+        cerr << "Usage: " << argv[0] << " " << argv[1] << " [-j N] [--cache-dir DIR] <file|dir|->..." << endl;
+        return 1;
+    }
+    unique_ptr<FormatCache> cache;
+    if (!cacheDir.empty())
+    {
+        cache.reset(new FormatCache(cacheDir, FORMAT_OPTIONS));
+        if (!cache->prepare())
         {
-            cerr << "Error: Unknown argument '" << Flag << "'." << endl;
-            cerr << "Usage: " << argv[0] << " <source_file.c>" << "debug" << endl;
+            cerr << "Error: Could not create cache directory " << cacheDir << endl;
             return 1;
         }
     }
-    else if (argc == 4)
+
+    vector<FileResult> results(files.size());
+    parallelFor(files.size(), workers, [&](size_t i)
+                { results[i] = check ? checkFile(files[i], cache.get()) : formatFileInPlace(files[i], cache.get()); });
+
+    int status = 0;
+    for (const auto &result : results)
     {
-        string Flag = argv[2];
-        if (Flag == "-debug")
+        if (!result.ok || (check && result.changed))
         {
-            debug = true;
-            cerr << "Error: too much argcs" << endl;
+            cerr << result.message << endl;
+            status = 1;
         }
-        else if (Flag == "-o")
+    }
+    return status;
+}
+
+// 用指定的 Parser 类型把 source 解析到 arena 中；出错时返回 nullptr，错误信息写入 error
+// -debug 使用 DebugParser：成功时把跟踪事件输出到标准输出，出错时转储到标准错误
+template <typename ParserType>
+static ASTNode *parseInto(const SourceBuffer &source, ASTArena &arena, FormatStats *stats, bool showTrace, string &error, vector<Diagnostic> *diagnostics = nullptr)
+{
+    ParserType parser(source, &arena);
+    parser.recoverErrors(diagnostics);
+    if (stats)
+        parser.timeLexer();
+    ASTNode *root = parser.program();
+    if (parser.failed())
+    {
+        if (stats)
+            stats->end("parse");
+        if (showTrace)
         {
-            debug = false;
-            outfilename = argv[3];
-            const char *infilename = argv[1];
-            ifstream infile(infilename);
-            ofstream outfile(outfilename);
-            if (!infile.is_open())
+            cerr << "Parser trace before the error (most recent last):" << endl;
+            parser.traceEvents().dump(cerr);
+        }
+        error = parser.error().message;
+        return nullptr;
+    }
+    if (stats)
+    {
+        stats->end("parse");
+        stats->lexer = parser.lexerCounters();
+        stats->nodes = parser.nodeCount();
+    }
+    if (showTrace)
+        parser.traceEvents().dump(cout);
+    return root;
+}
+
+// --server <socket>：常驻并通过 Unix 域套接字提供格式化服务
+static int runServer(int argc, char *argv[])
+{
+    if (argc != 3)
+    {
+        cerr << "Usage: " << argv[0] << " --server <socket>" << endl;
+        return 1;
+    }
+    FormatServer server(argv[2]);
+    string error;
+    if (!server.listen(error))
+    {
+        cerr << error << endl;
+        return 1;
+    }
+    server.run();
+    return 0;
+}
+
+static void printUsage(const char *prog)
+{
+    cerr << "Usage: " << prog << " <source_file.c|-> [-o <output_file.c>] [-j N] [--lines FIRST:LAST] [--flat-ast] [--recover] [--cache-dir DIR] [--dump-ast] [-debug] [--stats[=json]]" << endl;
+    cerr << "       " << prog << " -i [-j N] [--cache-dir DIR] <file|dir|->..." << endl;
+    cerr << "       " << prog << " --check [-j N] [--cache-dir DIR] <file|dir|->..." << endl;
+    cerr << "       " << prog << " --server <socket>" << endl;
+    cerr << "Set CFORMATTER_SOCKET (or pass --client <socket>) to format through a running server." << endl;
+}
+
+// 单文件模式的命令行选项
+struct Options
+{
+    string input;
+    string output;        // 为空时格式化结果写到标准输出
+    bool debug = false;   // 打印解析过程，并输出 AST
+    bool dumpAst = false; // 把 AST 树打印到标准输出
+    string stats;         // 非空时向标准错误输出统计信息："text" 或 "json"
+    string socket;        // 通过该套接字上的格式化服务处理，默认取 CFORMATTER_SOCKET
+    string cacheDir;      // 格式化结果缓存目录
+    int firstLine = 0;    // 大于 0 时只格式化 [firstLine, lastLine] 行
+    int lastLine = 0;
+    bool flatAst = false; // 用紧凑的结构数组 AST 解析与输出
+    bool recover = false; // 语法错误不中止：报告全部错误，无法解析的部分原样输出
+    size_t jobs = 0;      // 大文件并行解析与输出的线程数，0 表示 CPU 核数
+};
+
+static bool parseOptions(int argc, char *argv[], Options &options)
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+        if (arg == "-o")
+        {
+            if (i + 1 >= argc)
             {
-                cerr << "Error: Could not open file " << infilename << endl;
-                return 1;
+                cerr << "Error: Output file not specified." << endl;
+                return false;
             }
-            if (!outfile.is_open())
+            options.output = argv[++i];
+        }
+        else if (arg == "-debug")
+            options.debug = true;
+        else if (arg == "--dump-ast")
+            options.dumpAst = true;
+        else if (arg == "--flat-ast")
+            options.flatAst = true;
+        else if (arg == "--recover")
+            options.recover = true;
+        else if (arg == "--stats" || arg == "--stats=text")
+            options.stats = "text";
+        else if (arg == "--stats=json")
+            options.stats = "json";
+        else if (arg == "--client")
+        {
+            if (i + 1 >= argc)
             {
-                cerr << "Error: Could not open file " << outfilename << endl;
-                return 1;
+                cerr << "Error: Socket path not specified." << endl;
+                return false;
             }
-
-            try
+            options.socket = argv[++i];
+        }
+        else if (arg == "--cache-dir")
+        {
+            if (i + 1 >= argc)
             {
-                Parser parser(infile, debug);
-                ASTNode *root = parser.program();
-                if (root)
-                {
-                    root->print();
-                    root->printToFile(outfile);
-                }
-                cout << "Finished printing AST." << endl;
+                cerr << "Error: Cache directory not specified." << endl;
+                return false;
             }
-            catch (const std::runtime_error &e)
+            options.cacheDir = argv[++i];
+        }
+        else if (arg == "-j")
+        {
+            if (i + 1 >= argc || atoi(argv[i + 1]) <= 0)
             {
-                cerr << e.what() << endl;
-                return 1;
+                cerr << "Error: -j expects a positive number of workers." << endl;
+                return false;
             }
+            options.jobs = (size_t)atoi(argv[++i]);
+        }
+        else if (arg == "--lines")
+        {
+            int first, last;
+            char tail;
+            if (i + 1 >= argc || sscanf(argv[i + 1], "%d:%d%c", &first, &last, &tail) != 2 || first < 1 || last < first)
+            {
+                cerr << "Error: --lines expects a range FIRST:LAST." << endl;
+                return false;
+            }
+            options.firstLine = first;
+            options.lastLine = last;
+            ++i;
+        }
+        else if (options.input.empty() && (arg == "-" || arg[0] != '-'))
+            options.input = arg;
+        else
+        {
+            cerr << "Error: Unknown argument '" << arg << "'." << endl;
+            return false;
+        }
+    }
+    if (options.input.empty())
+    {
+        cerr << "Error: No input file specified." << endl;
+        return false;
+    }
+    if (options.socket.empty())
+    {
+        const char *env = getenv("CFORMATTER_SOCKET");
+        if (env)
+            options.socket = env;
+    }
+    return true;
+}
 
-            return 0;
+// 依次尝试缓存、格式化服务（服务端不可用时静默跳过）、本地格式化，把结果写入 outfd
+static int formatPlain(const Options &options, const SourceBuffer &source, int outfd)
+{
+    unique_ptr<FormatCache> cache;
+    if (!options.cacheDir.empty())
+    {
+        cache.reset(new FormatCache(options.cacheDir, FORMAT_OPTIONS));
+        if (!cache->prepare())
+            cache.reset(); // 缓存不可用时照常格式化
+    }
+    string output, error;
+    FormatCache::Lookup hit = cache ? cache->lookup(source, output) : FormatCache::Lookup::Miss;
+    if (hit == FormatCache::Lookup::Miss)
+    {
+        int rc = options.socket.empty() ? -1 : formatViaServer(options.socket, options.input, source, output);
+        if (rc < 0)
+        {
+            output.clear();
+            ASTArena arena;
+            formatToString(source, arena, output, error);
         }
+        else if (rc != 0)
+            error.swap(output);
+        if (error.empty() && cache)
+            cache->store(source, output);
+    }
+
+    bool ok = error.empty();
+    if (!ok)
+        cerr << error << endl;
+    else if (!(hit == FormatCache::Lookup::Unchanged ? writeAll(outfd, source.data(), source.size())
+                                                     : writeAll(outfd, output.data(), output.size())))
+    {
+        cerr << "Error: Could not write file " << (options.output.empty() ? "<stdout>" : options.output) << endl;
+        ok = false;
+    }
+    return ok ? 0 : 1;
+}
+
+// 只格式化选中的行，其余字节原样输出
+static int formatRange(const Options &options, const SourceBuffer &source, int outfd)
+{
+    int status = 0;
+    ASTArena arena;
+    RangeEdit edit;
+    string error;
+    if (!formatLines(source, options.firstLine, options.lastLine, arena, edit, error))
+    {
+        cerr << error << endl;
+        status = 1;
+    }
+    else
+    {
+        FdSink sink(outfd);
+        sink.write(source.data(), edit.begin);
+        sink << edit.text;
+        sink.write(source.data() + edit.end, source.size() - edit.end);
+        sink.flush();
+        if (!sink.good())
+        {
+            cerr << "Error: Could not write file " << (options.output.empty() ? "<stdout>" : options.output) << endl;
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// --flat-ast：解析为紧凑 AST 后输出
+static int formatFlat(const Options &options, const SourceBuffer &source, int outfd, FormatStats *stats)
+{
+    int status = 0;
+    FlatAST tree;
+    string error;
+    bool parsed = parseFlat(source, tree, error, stats ? &stats->lexer : nullptr);
+    if (stats)
+    {
+        stats->end("parse");
+        stats->nodes = tree.nodeCount();
+    }
+    if (!parsed)
+    {
+        cerr << error << endl;
+        status = 1;
+    }
+    else
+    {
+        FdSink sink(outfd);
+        tree.print(sink);
+        sink.flush();
+        if (stats)
+        {
+            stats->outputBytes = sink.bytesWritten();
+            stats->end("print");
+        }
+        if (!sink.good())
+        {
+            cerr << "Error: Could not write file " << (options.output.empty() ? "<stdout>" : options.output) << endl;
+            status = 1;
+        }
+    }
+    if (stats)
+    {
+        if (options.stats == "json")
+            stats->printJson(cerr);
         else
+            stats->printText(cerr);
+    }
+    return status;
+}
+
+// 输出完整时用它替换 -o 指定的文件，否则放弃，目标保持原样
+static int finishOutput(const Options &options, OutputFile &outFile, int status, bool complete)
+{
+    if (options.output.empty())
+        return status;
+    if (!complete)
+    {
+        outFile.discard();
+        return status;
+    }
+    if (!outFile.commit())
+    {
+        cerr << "Error: Could not write file " << options.output << endl;
+        return 1;
+    }
+    return status;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc >= 2 && string(argv[1]) == "-i")
+    {
+        return formatMany(argc, argv, false);
+    }
+    if (argc >= 2 && string(argv[1]) == "--check")
+    {
+        return formatMany(argc, argv, true);
+    }
+    if (argc >= 2 && string(argv[1]) == "--server")
+    {
+        return runServer(argc, argv);
+    }
+    Options options;
+    if (!parseOptions(argc, argv, options))
+    {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    unique_ptr<FormatStats> stats;
+    if (!options.stats.empty())
+    {
+        stats.reset(new FormatStats());
+        stats->file = options.input;
+        stats->begin();
+    }
+    SourceBuffer source;
+    if (!loadSource(options.input, source))
+    {
+        cerr << "Error: Could not open file " << options.input << endl;
+        return 1;
+    }
+    if (stats)
+    {
+        stats->sourceBytes = source.size();
+        stats->end("load");
+    }
+    // 诊断模式（-debug / --dump-ast）占用标准输出，此时只有给出 -o 才输出格式化结果
+    bool dumpAst = options.dumpAst || options.debug;
+    bool format = !options.output.empty() || !dumpAst;
+    // -o 的内容先写到临时文件，完整输出后才替换目标；出错时目标（可能就是输入文件）保持原样
+    OutputFile outFile;
+    int outfd = STDOUT_FILENO;
+    if (!options.output.empty())
+    {
+        if (!outFile.open(options.output))
         {
-            cerr << "Error: Unknown argument '" << Flag << "'." << endl;
-            cerr << "Usage: " << argv[0] << " <source_file.c> -o <output_file.c>" << endl;
+            cerr << "Error: Could not open file " << options.output << endl;
             return 1;
         }
+        outfd = outFile.fd();
     }
-    return 0;
-}
\ No newline at end of file
+
+    if (options.firstLine > 0)
+    {
+        int status = formatRange(options, source, outfd);
+        return finishOutput(options, outFile, status, status == 0);
+    }
+
+    // 只输出格式化结果且启用了缓存或格式化服务时，走不需要 AST 的快速路径
+    if (format && !dumpAst && !stats && !options.recover && (!options.socket.empty() || !options.cacheDir.empty()))
+    {
+        int status = formatPlain(options, source, outfd);
+        return finishOutput(options, outFile, status, status == 0);
+    }
+
+    if (options.flatAst && format && !dumpAst && !options.recover)
+    {
+        int status = formatFlat(options, source, outfd, stats.get());
+        return finishOutput(options, outFile, status, status == 0);
+    }
+
+    int status = 0;
+    ASTArena arena;
+    ParallelParser parallel(source, arena); // 持有各块的 arena，需存活到输出结束
+    size_t workers = options.jobs ? options.jobs : defaultWorkerCount();
+    vector<Diagnostic> diagnostics;
+    string error;
+    ASTNode *root;
+    if (options.debug)
+        root = parseInto<DebugParser>(source, arena, stats.get(), true, error, options.recover ? &diagnostics : nullptr);
+    else
+    {
+        parallel.recoverErrors(options.recover ? &diagnostics : nullptr);
+        if (stats)
+            parallel.timeLexer();
+        root = parallel.program(workers);
+        if (stats)
+        {
+            stats->end("parse");
+            stats->lexer = parallel.lexerCounters();
+            stats->nodes = parallel.nodeCount();
+        }
+        if (parallel.failed())
+            error = parallel.error().message;
+    }
+    for (const auto &d : diagnostics)
+        cerr << d.message << endl;
+    if (!diagnostics.empty())
+        status = 1;
+    if (!error.empty())
+    {
+        cerr << error << endl;
+        status = 1;
+    }
+    if (root && dumpAst)
+    {
+        root->print();
+        cout.flush();
+    }
+    bool complete = false; // 输出完整写出；--recover 报告了错误时也保留输出
+    if (root && format)
+    {
+        size_t written = 0;
+        bool good = printProgram(*static_cast<ProgramNode *>(root), workers, outfd, &written);
+        complete = good;
+        if (stats)
+        {
+            stats->outputBytes = written;
+            stats->end("print");
+        }
+        if (!good)
+        {
+            cerr << "Error: Could not write file " << (options.output.empty() ? "<stdout>" : options.output) << endl;
+            status = 1;
+        }
+    }
+    if (options.debug && root)
+        cout << "Finished printing AST." << endl;
+    if (stats)
+    {
+        if (options.stats == "json")
+            stats->printJson(cerr);
+        else
+            stats->printText(cerr);
+    }
+    return finishOutput(options, outFile, status, complete);
+}
@@ -0,0 +1,143 @@
+// IncrementalDocument 回归测试：每次编辑后把增量结果与对编辑后全文的完整解析比较
+// 用法：incremental_test [source_file.c ...]
+// 先跑一组固定编辑（含跨越顶层定义边界的编辑），再对每个给出的文件做随机编辑
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <random>
+#include "../SourceBuffer.hpp"
+#include "../Lexer-Paser.hpp"
+#include "../OutputSink.hpp"
+#include "../Formatter.hpp"
+#include "../Incremental.hpp"
+
+using namespace std;
+
+static int failures = 0;
+
+// 比较文档当前状态与完整解析：合法时输出一致，非法时两边都报告同一个错误
+static bool agrees(const IncrementalDocument &doc, bool updated, const string &what)
+{
+    const string &text = doc.source();
+    ASTArena arena;
+    string expected, error;
+    bool ok = formatToString(SourceBuffer(text.data(), text.size()), arena, expected, error);
+    string actual;
+    if (doc.isValid())
+    {
+        StringSink sink(actual);
+        doc.print(sink);
+    }
+    if (ok == updated && ok == doc.isValid() && (ok ? actual == expected : error == doc.error()))
+        return true;
+    ++failures;
+    cerr << "FAIL " << what << "\n"
+         << "  full parse: " << (ok ? "ok" : error) << "\n"
+         << "  incremental: " << (updated ? "ok" : doc.error()) << "\n";
+    if (ok && doc.isValid())
+        cerr << "--- expected ---\n" << expected << "--- actual ---\n" << actual;
+    return false;
+}
+
+static bool edit(IncrementalDocument &doc, const string &what, size_t offset, size_t removed, const string &inserted)
+{
+    bool updated = doc.applyEdit(offset, removed, inserted.data(), inserted.size());
+    return agrees(doc, updated, what);
+}
+
+// 把 doc 中第一次出现的 from 替换为 to
+static bool replace(IncrementalDocument &doc, const string &what, const string &from, const string &to)
+{
+    size_t at = doc.source().find(from);
+    if (at == string::npos)
+    {
+        ++failures;
+        cerr << "FAIL " << what << ": \"" << from << "\" not found\n";
+        return false;
+    }
+    return edit(doc, what, at, from.size(), to);
+}
+
+static void scriptedEdits()
+{
+    const string source =
+        "int f(int a) {\n\treturn a ;\n}\n"
+        "int g(int b) {\n\treturn b + 1 ;\n}\n"
+        "int x = 1 ;\n"
+        "int h() {\n\twhile (x) {\n\t\tx = x - 1 ;\n\t}\n\treturn x ;\n}\n";
+    IncrementalDocument doc;
+    agrees(doc, doc.reset(source.data(), source.size()), "reset");
+
+    // 定义内部的编辑
+    if (replace(doc, "edit inside a body", "return b + 1", "return b * 2") && doc.reparsedItems() != 1)
+    {
+        ++failures;
+        cerr << "FAIL edit inside a body: reparsed " << doc.reparsedItems() << " of " << doc.itemCount() << " definitions\n";
+    }
+    // 删掉 f 的结尾与 g 的开头，两个定义合并为一个
+    replace(doc, "merge two definitions", "\treturn a ;\n}\nint g(int b) {\n", "\tint b = a ;\n");
+    // 在定义之间插入新定义
+    replace(doc, "insert a definition", "int x = 1 ;\n", "int x = 1 ;\nint y = 2 ;\nint k() {\n\treturn y ;\n}\n");
+    // 把一个定义拆成两个
+    replace(doc, "split a definition", "\tint b = a ;\n", "\treturn a ;\n}\nint g(int b) {\n");
+    // 跨越边界的替换：从 k 的函数体一直改到 h 的参数表
+    replace(doc, "replace across a boundary", "return y ;\n}\nint h() {", "return y + x ;\n}\nint h(int n) {");
+    // 删除跨越边界后产生语法错误，再改回合法
+    replace(doc, "break across a boundary", "}\nint h", "int h");
+    replace(doc, "repair across a boundary", "int h", "}\nint h");
+    // 删除整个定义与在文件末尾追加
+    replace(doc, "delete a definition", "int y = 2 ;\n", "");
+    edit(doc, "append at end", doc.source().size(), 0, "int z ;\n");
+    // 整体内容的 update 走同一条增量路径
+    string updated = doc.source();
+    updated.replace(updated.find("int x = 1"), 9, "int x = 3");
+    agrees(doc, doc.update(updated.data(), updated.size()), "update");
+}
+
+// 随机编辑：插入的内容取自原文的任意片段，常常跨越顶层边界；出错后撤销，回到合法状态继续
+static void randomEdits(const string &path, const string &source, unsigned seed, int rounds)
+{
+    IncrementalDocument doc;
+    if (!agrees(doc, doc.reset(source.data(), source.size()), path + ": reset") || !doc.isValid())
+        return;
+    mt19937 rng(seed);
+    for (int i = 0; i < rounds; ++i)
+    {
+        const string &text = doc.source();
+        size_t offset = rng() % (text.size() + 1);
+        size_t removed = rng() % (min<size_t>(text.size() - offset, 64) + 1);
+        size_t from = rng() % (source.size() + 1);
+        string inserted = source.substr(from, rng() % 65);
+        string undo = text.substr(offset, removed);
+
+        ostringstream what;
+        what << path << ": edit " << i << " (seed " << seed << ", offset " << offset << ", removed " << removed << ")";
+        if (!edit(doc, what.str(), offset, removed, inserted))
+            return;
+        if (!doc.isValid() && !edit(doc, what.str() + " undo", offset, inserted.size(), undo))
+            return;
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    scriptedEdits();
+    for (int i = 1; i < argc; ++i)
+    {
+        ifstream in(argv[i], ios::binary);
+        if (!in)
+        {
+            cerr << "Error: Could not open file " << argv[i] << "\n";
+            return 1;
+        }
+        string source((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+        randomEdits(argv[i], source, 1 + i, 300);
+    }
+    if (failures)
+    {
+        cerr << failures << " failure(s)\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,2 @@
+int g( { }
+int h(void){return 1;}
@@ -0,0 +1,11 @@
+int f(int x)
+{
+    switch (x)
+    {
+    case 1:
+        ] break;
+    default:
+        return 1;
+    }
+    return 0;
+}
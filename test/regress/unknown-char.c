@@ -0,0 +1,3 @@
+int a = 1 @ 2;
+int f(){int x; x = @; return x;}
+int k(){return 2;}